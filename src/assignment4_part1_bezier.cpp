@@ -5,11 +5,70 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <cstring>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <cstdlib>
+#include <unordered_map>
+#include "thread_pool.h"
+#include "bezier_surface.h"
+#include "bezier_forward_difference.h"
+#include "bezier_tess_shaders.h"
+#include "mesh_cache.h"
+#include "vertex_compression.h"
+#include "mesh_optimizer.h"
+#include "parametric_mesh.h"
+#include "simd_math.h"
+#include "shader_program.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BEZIER_SIMD_X86 1
+#else
+#define BEZIER_SIMD_X86 0
+#endif
 
 // Global variables
-unsigned int shaderProgram;
+ShaderProgram shaderProgram;
+FrameUniformBuffer frameUniforms;
+
+// Per-object uniform locations, resolved once after linking
+struct PhongUniforms {
+    int model, objectColor, ka, kd, ks, shininess;
+    int positionMin, positionScale;
+} phong;
 unsigned int patchVAO, patchVBO, patchEBO;
 unsigned int controlPointsVAO, controlPointsVBO;
+
+// Control point markers: one vertex per point of every patch, drawn with a
+// single glDrawArrays. Changing the selection rewrites only the `selected`
+// byte of the old and new point.
+ShaderProgram pointShaderProgram;
+int pointModelLocation;
+
+struct ControlPointVertex {
+    float position[3];
+    float size;              // Point size in pixels (active patch larger)
+    unsigned char selected;  // 1 for the selected point (drawn yellow, 1.5x size)
+    unsigned char padding[3];
+};
+
+// Hardware tessellation program (OpenGL 4.0). It reads the control points
+// straight from controlPointsVBO as 16-vertex patches.
+ShaderProgram tessShaderProgram;
+unsigned int tessPatchVAO;
+
+struct TessUniforms {
+    int model, objectColor, ka, kd, ks, shininess;
+    int viewportSize, pixelsPerSegment, maxTessLevel;
+} tess;
+
+const float ACTIVE_POINT_SIZE = 8.0f;
+const float INACTIVE_POINT_SIZE = 4.0f;
+
+int highlightedVertex = -1;  // Vertex whose selected byte is currently 1
 unsigned int axesVAO, axesVBO;
 
 // Control points (4x4 grid, 16 points total)
@@ -37,8 +96,57 @@ std::vector<float> controlPoints = {
      1.5f,  1.5f,  0.0f   // [3,3]
 };
 
+// Patches loaded from file (--patches); controlPoints mirrors the active patch
+const char* patchFile = "src/control_points.txt";
+BezierSurface surface;
+int activePatch = 0;
+
+// More than one patch: tessellate the whole surface into one buffer
+bool multiPatch() {
+    return surface.patchCount() > 1;
+}
+
 // Tessellation resolution
 int resolution = 10;
+int maxResolution = 50;  // Upper limit for +/> keys (--max-resolution)
+
+// Tessellation worker threads (--threads); 1 = tessellate on the calling thread
+int tessellationThreads = std::max(1u, std::thread::hardware_concurrency());
+
+// GPU tessellation (H key, --gpu-tessellation): tessellation shaders evaluate
+// the patches with levels chosen from their projected size on screen
+bool gpuTessellation = false;
+bool gpuTessellationSupported = false;
+bool cpuMeshStale = false;          // Control points moved while on the GPU path
+float tessPixelsPerSegment = 8.0f;  // Target edge length in pixels (--tess-pixels)
+float maxTessLevel = 64.0f;         // Clamped to GL_MAX_TESS_GEN_LEVEL at init
+
+// Window size, for screen-space tessellation levels
+int windowWidth = 800;
+int windowHeight = 600;
+
+// Startup mesh cache directory (--no-mesh-cache disables it)
+const char* meshCacheDir = "mesh_cache";
+bool meshCacheEnabled = true;
+
+// Tessellation evaluator
+enum EvaluatorMode {
+    EVAL_BASIS_TABLE = 0,
+    EVAL_FORWARD_DIFFERENCE = 1,
+    EVAL_SIMD_BATCH = 2
+};
+EvaluatorMode evaluatorMode = EVAL_BASIS_TABLE;
+
+const char* evaluatorModeName(EvaluatorMode mode) {
+    switch(mode) {
+        case EVAL_FORWARD_DIFFERENCE: return "forward differencing";
+        case EVAL_SIMD_BATCH: return "SIMD batch";
+        default: return "basis table";
+    }
+}
+
+// Forward differencing re-seeds from the exact polynomial every N steps (0 = never)
+int forwardDiffReseedInterval = 16;
 
 // Selected control point (0-15)
 int selectedPoint = 0;
@@ -63,33 +171,51 @@ float shininess = 32.0f;
 // Shader source code
 const char* vertexShaderSource = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec4 aPos;     // unorm16 within the mesh bounds
+layout (location = 1) in vec2 aNormal;  // snorm16 octahedral
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+uniform vec3 positionMin;
+uniform vec3 positionScale;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 LightDir;
 out vec3 ViewDir;
 
+// Octahedral normal decode (octDecode in vertex_compression.h)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = positionMin + aPos.xyz * positionScale;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * octDecode(aNormal);
     
     // Transform light and view positions to world space
-    vec3 worldLightPos = lightPos;
-    vec3 worldViewPos = viewPos;
+    vec3 worldLightPos = lightPos.xyz;
+    vec3 worldViewPos = viewPos.xyz;
     
     LightDir = normalize(worldLightPos - FragPos);
     ViewDir = normalize(worldViewPos - FragPos);
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
 )";
 
@@ -104,9 +230,17 @@ uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float shininess;
-uniform vec3 lightColor;
 uniform vec3 objectColor;
 
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
 out vec4 FragColor;
 
 void main()
@@ -116,16 +250,16 @@ void main()
     vec3 viewDir = normalize(ViewDir);
     
     // Ambient component
-    vec3 ambient = ka * lightColor * objectColor;
+    vec3 ambient = ka * lightColor.rgb * objectColor;
     
     // Diffuse component
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = kd * diff * lightColor * objectColor;
+    vec3 diffuse = kd * diff * lightColor.rgb * objectColor;
     
     // Specular component
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = ks * spec * lightColor;
+    vec3 specular = ks * spec * lightColor.rgb;
     
     // Combine components
     vec3 result = ambient + diffuse + specular;
@@ -133,6 +267,46 @@ void main()
 }
 )";
 
+// Control point markers: size and highlight come from vertex attributes
+const char* pointVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in float aSize;
+layout (location = 2) in float aSelected;
+
+uniform mat4 model;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
+out vec3 PointColor;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_PointSize = aSelected > 0.5 ? aSize * 1.5 : aSize;
+    PointColor = aSelected > 0.5 ? vec3(1.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+}
+)";
+
+const char* pointFragmentShaderSource = R"(
+#version 330 core
+in vec3 PointColor;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(PointColor, 1.0);
+}
+)";
+
 // Bezier basis functions
 float bezierBasis(int i, float t) {
     float oneMinusT = 1.0f - t;
@@ -243,18 +417,98 @@ void computeNormal(float u, float v, float* normal) {
     }
 }
 
-// Generate patch mesh
-void generatePatchMesh() {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+// Basis tables for a uniform tessellation grid.
+// Row k holds B0..B3 (and their derivatives) at t = k / resolution, so a
+// (resolution+1)^2 grid needs only 2 * (resolution+1) basis evaluations.
+struct BasisTable {
+    int resolution = 0;
+    std::vector<float> basis;   // (resolution + 1) * 4
+    std::vector<float> dBasis;  // (resolution + 1) * 4
+};
+
+BasisTable patchBasisTable;
+
+// Fill the table for the given resolution (no-op if already built)
+void buildBasisTable(int res, BasisTable& table) {
+    if (table.resolution == res && !table.basis.empty()) {
+        return;
+    }
+    
+    table.resolution = res;
+    table.basis.resize((res + 1) * 4);
+    table.dBasis.resize((res + 1) * 4);
+    
+    for (int k = 0; k <= res; k++) {
+        // Same arithmetic as the per-sample evaluators so results match bit for bit
+        float t = (float)k / res;
+        t = std::max(0.0f, std::min(1.0f, t));
+        float oneMinusT = 1.0f - t;
+        
+        for (int i = 0; i < 4; i++) {
+            table.basis[k * 4 + i] = bezierBasis(i, t);
+        }
+        table.dBasis[k * 4 + 0] = -3.0f * oneMinusT * oneMinusT;
+        table.dBasis[k * 4 + 1] = 3.0f * (oneMinusT * oneMinusT - 2.0f * oneMinusT * t);
+        table.dBasis[k * 4 + 2] = 3.0f * (2.0f * oneMinusT * t - t * t);
+        table.dBasis[k * 4 + 3] = 3.0f * t * t;
+    }
+}
+
+// Evaluate position and normal at one grid vertex in a single pass over
+// the control points, using precomputed basis values for u (bu, dbu) and v (bv, dbv)
+void evaluatePatchVertex(const float* bu, const float* dbu,
+                         const float* bv, const float* dbv, float* out) {
+    float pos[3] = {0.0f, 0.0f, 0.0f};
+    float du[3] = {0.0f, 0.0f, 0.0f};
+    float dv[3] = {0.0f, 0.0f, 0.0f};
+    const float* cp = controlPoints.data();
+    
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            const float* p = cp + (i * 4 + j) * 3;
+            float basis = bu[i] * bv[j];
+            float basisDu = dbu[i] * bv[j];
+            float basisDv = bu[i] * dbv[j];
+            
+            pos[0] += p[0] * basis;
+            pos[1] += p[1] * basis;
+            pos[2] += p[2] * basis;
+            du[0] += p[0] * basisDu;
+            du[1] += p[1] * basisDu;
+            du[2] += p[2] * basisDu;
+            dv[0] += p[0] * basisDv;
+            dv[1] += p[1] * basisDv;
+            dv[2] += p[2] * basisDv;
+        }
+    }
+    
+    out[0] = pos[0];
+    out[1] = pos[1];
+    out[2] = pos[2];
     
-    int numVertices = (resolution + 1) * (resolution + 1);
+    // Cross product: normal = du x dv (same as computeNormal)
+    float* normal = out + 3;
+    normal[0] = du[1] * dv[2] - du[2] * dv[1];
+    normal[1] = du[2] * dv[0] - du[0] * dv[2];
+    normal[2] = du[0] * dv[1] - du[1] * dv[0];
     
-    // Generate vertices
-    for (int j = 0; j <= resolution; j++) {
-        float v = (float)j / resolution;
-        for (int i = 0; i <= resolution; i++) {
-            float u = (float)i / resolution;
+    float len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (len > 1e-6f) {
+        normal[0] /= len;
+        normal[1] /= len;
+        normal[2] /= len;
+    }
+}
+
+// Reference tessellation: evaluates every vertex with the per-sample evaluators
+void tessellatePatchReference(int res, std::vector<float>& vertices) {
+    vertices.clear();
+    vertices.reserve((res + 1) * (res + 1) * 6);
+    
+    for (int j = 0; j <= res; j++) {
+        float v = (float)j / res;
+        for (int i = 0; i <= res; i++) {
+            float u = (float)i / res;
             
             // Position
             float pos[3];
@@ -271,190 +525,1248 @@ void generatePatchMesh() {
             vertices.push_back(normal[2]);
         }
     }
-    
-    // Generate indices for triangles
-    for (int j = 0; j < resolution; j++) {
-        for (int i = 0; i < resolution; i++) {
-            int topLeft = j * (resolution + 1) + i;
-            int topRight = topLeft + 1;
-            int bottomLeft = (j + 1) * (resolution + 1) + i;
-            int bottomRight = bottomLeft + 1;
-            
-            // First triangle
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-            
-            // Second triangle
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
+}
+
+// Table-driven tessellation of grid rows [rowBegin, rowEnd) into a pre-sized
+// vertex array (interleaved position + normal, 6 floats per vertex).
+// The basis table must already be built for res.
+void tessellatePatchRows(int res, int rowBegin, int rowEnd, float* vertices) {
+    const float* basis = patchBasisTable.basis.data();
+    const float* dBasis = patchBasisTable.dBasis.data();
+    float* out = vertices + (size_t)rowBegin * (res + 1) * 6;
+    
+    for (int j = rowBegin; j < rowEnd; j++) {
+        for (int i = 0; i <= res; i++) {
+            evaluatePatchVertex(basis + i * 4, dBasis + i * 4,
+                                basis + j * 4, dBasis + j * 4, out);
+            out += 6;
         }
     }
-    
-    // Update VAO, VBO, EBO
-    if (patchVAO == 0) {
-        glGenVertexArrays(1, &patchVAO);
-        glGenBuffers(1, &patchVBO);
-        glGenBuffers(1, &patchEBO);
+}
+
+// Table-driven tessellation: position and normal from cached basis values
+void tessellatePatch(int res, std::vector<float>& vertices) {
+    buildBasisTable(res, patchBasisTable);
+    vertices.resize((size_t)(res + 1) * (res + 1) * 6);
+    tessellatePatchRows(res, 0, res + 1, vertices.data());
+}
+
+// Structure-of-arrays results of a batch evaluation (count floats per array)
+struct PatchSamples {
+    std::vector<float> position[3];
+    std::vector<float> du[3];
+    std::vector<float> dv[3];
+    std::vector<float> normal[3];
+    
+    void resize(size_t count) {
+        for (int k = 0; k < 3; k++) {
+            position[k].resize(count);
+            du[k].resize(count);
+            dv[k].resize(count);
+            normal[k].resize(count);
+        }
+    }
+};
+
+// Output pointers in the order position xyz, du xyz, dv xyz, normal xyz
+struct PatchSampleOutputs {
+    float* dst[12];
+};
+
+// Instruction set used by evaluateBezierPatchBatch
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2 = 1,
+    SIMD_AVX2 = 2
+};
+
+const char* simdLevelName(SimdLevel level) {
+    switch(level) {
+        case SIMD_AVX2: return "AVX2";
+        case SIMD_SSE2: return "SSE2";
+        default: return "scalar";
     }
-    
-    glBindVertexArray(patchVAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_DYNAMIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    glBindVertexArray(0);
 }
 
-// Generate control points for rendering
-void generateControlPoints() {
-    std::vector<float> vertices;
-    
-    for (size_t i = 0; i < controlPoints.size(); i += 3) {
-        vertices.push_back(controlPoints[i]);
-        vertices.push_back(controlPoints[i + 1]);
-        vertices.push_back(controlPoints[i + 2]);
+SimdLevel detectSimdLevel() {
+#if BEZIER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
     }
+    return SIMD_SSE2;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+SimdLevel simdLevel = detectSimdLevel();
+
+// One sample with scalar math (batch tail and non-x86 fallback).
+// Operation order matches the per-sample evaluators exactly.
+void evaluatePatchSampleScalar(float u, float v, const PatchSampleOutputs& out, size_t n) {
+    u = std::max(0.0f, std::min(1.0f, u));
+    v = std::max(0.0f, std::min(1.0f, v));
     
-    if (controlPointsVAO == 0) {
-        glGenVertexArrays(1, &controlPointsVAO);
-        glGenBuffers(1, &controlPointsVBO);
+    float bu[4], bv[4], dbu[4], dbv[4];
+    float oneMinusU = 1.0f - u;
+    float oneMinusV = 1.0f - v;
+    for (int i = 0; i < 4; i++) {
+        bu[i] = bezierBasis(i, u);
+        bv[i] = bezierBasis(i, v);
+    }
+    dbu[0] = -3.0f * oneMinusU * oneMinusU;
+    dbu[1] = 3.0f * (oneMinusU * oneMinusU - 2.0f * oneMinusU * u);
+    dbu[2] = 3.0f * (2.0f * oneMinusU * u - u * u);
+    dbu[3] = 3.0f * u * u;
+    dbv[0] = -3.0f * oneMinusV * oneMinusV;
+    dbv[1] = 3.0f * (oneMinusV * oneMinusV - 2.0f * oneMinusV * v);
+    dbv[2] = 3.0f * (2.0f * oneMinusV * v - v * v);
+    dbv[3] = 3.0f * v * v;
+    
+    float pos[3] = {0.0f, 0.0f, 0.0f};
+    float du[3] = {0.0f, 0.0f, 0.0f};
+    float dv[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            const float* p = &controlPoints[(i * 4 + j) * 3];
+            float basis = bu[i] * bv[j];
+            float basisDu = dbu[i] * bv[j];
+            float basisDv = bu[i] * dbv[j];
+            for (int k = 0; k < 3; k++) {
+                pos[k] += p[k] * basis;
+                du[k] += p[k] * basisDu;
+                dv[k] += p[k] * basisDv;
+            }
+        }
     }
     
-    glBindVertexArray(controlPointsVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    glBindVertexArray(0);
+    float normal[3];
+    crossNormalize(du, dv, normal);
+    for (int k = 0; k < 3; k++) {
+        out.dst[k][n] = pos[k];
+        out.dst[3 + k][n] = du[k];
+        out.dst[6 + k][n] = dv[k];
+        out.dst[9 + k][n] = normal[k];
+    }
 }
 
-// Generate axes (positions only, colors set in shader)
-void generateAxes() {
-    float vertices[] = {
-        // X axis
-        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin with dummy normal
-        0.5f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // X end with dummy normal
-        // Y axis
-        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin
-        0.0f, 0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  // Y end
-        // Z axis
-        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin
-        0.0f, 0.0f, 0.5f,  0.0f, 0.0f, 1.0f   // Z end
-    };
-    
-    if (axesVAO == 0) {
-        glGenVertexArrays(1, &axesVAO);
-        glGenBuffers(1, &axesVBO);
+#if BEZIER_SIMD_X86
+// Basis and derivative-basis values for 4 parameters (same operation order as bezierBasis)
+static inline void bezierBasisSSE(__m128 t, __m128* b, __m128* db) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+    t = _mm_max_ps(_mm_setzero_ps(), _mm_min_ps(one, t));
+    __m128 s = _mm_sub_ps(one, t);
+    
+    b[0] = _mm_mul_ps(_mm_mul_ps(s, s), s);
+    b[1] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(three, s), s), t);
+    b[2] = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(three, s), t), t);
+    b[3] = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    
+    __m128 twoST = _mm_mul_ps(_mm_mul_ps(two, s), t);
+    db[0] = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(-3.0f), s), s);
+    db[1] = _mm_mul_ps(three, _mm_sub_ps(_mm_mul_ps(s, s), twoST));
+    db[2] = _mm_mul_ps(three, _mm_sub_ps(twoST, _mm_mul_ps(t, t)));
+    db[3] = _mm_mul_ps(_mm_mul_ps(three, t), t);
+}
+
+// 4 samples per iteration with SSE2 (baseline on x86-64); returns samples processed
+size_t evaluatePatchBatchSSE2(const float* u, const float* v, size_t count, const PatchSampleOutputs& out) {
+    const float* cp = controlPoints.data();
+    size_t n = 0;
+    
+    for (; n + 4 <= count; n += 4) {
+        __m128 bu[4], dbu[4], bv[4], dbv[4];
+        bezierBasisSSE(_mm_loadu_ps(u + n), bu, dbu);
+        bezierBasisSSE(_mm_loadu_ps(v + n), bv, dbv);
+        
+        __m128 pos[3], du[3], dv[3];
+        for (int k = 0; k < 3; k++) {
+            pos[k] = du[k] = dv[k] = _mm_setzero_ps();
+        }
+        
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                const float* p = cp + (i * 4 + j) * 3;
+                __m128 basis = _mm_mul_ps(bu[i], bv[j]);
+                __m128 basisDu = _mm_mul_ps(dbu[i], bv[j]);
+                __m128 basisDv = _mm_mul_ps(bu[i], dbv[j]);
+                for (int k = 0; k < 3; k++) {
+                    __m128 c = _mm_set1_ps(p[k]);
+                    pos[k] = _mm_add_ps(pos[k], _mm_mul_ps(c, basis));
+                    du[k] = _mm_add_ps(du[k], _mm_mul_ps(c, basisDu));
+                    dv[k] = _mm_add_ps(dv[k], _mm_mul_ps(c, basisDv));
+                }
+            }
+        }
+        
+        // Normal = normalize(du x dv), left unnormalized where the length is ~0
+        __m128 normal[3];
+        normal[0] = _mm_sub_ps(_mm_mul_ps(du[1], dv[2]), _mm_mul_ps(du[2], dv[1]));
+        normal[1] = _mm_sub_ps(_mm_mul_ps(du[2], dv[0]), _mm_mul_ps(du[0], dv[2]));
+        normal[2] = _mm_sub_ps(_mm_mul_ps(du[0], dv[1]), _mm_mul_ps(du[1], dv[0]));
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], normal[0]),
+                                                       _mm_mul_ps(normal[1], normal[1])),
+                                            _mm_mul_ps(normal[2], normal[2])));
+        __m128 valid = _mm_cmpgt_ps(len, _mm_set1_ps(1e-6f));
+        for (int k = 0; k < 3; k++) {
+            __m128 scaled = _mm_div_ps(normal[k], len);
+            normal[k] = _mm_or_ps(_mm_and_ps(valid, scaled), _mm_andnot_ps(valid, normal[k]));
+        }
+        
+        for (int k = 0; k < 3; k++) {
+            _mm_storeu_ps(out.dst[k] + n, pos[k]);
+            _mm_storeu_ps(out.dst[3 + k] + n, du[k]);
+            _mm_storeu_ps(out.dst[6 + k] + n, dv[k]);
+            _mm_storeu_ps(out.dst[9 + k] + n, normal[k]);
+        }
     }
-    
-    glBindVertexArray(axesVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, axesVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    glBindVertexArray(0);
+    return n;
 }
 
-// Matrix functions
-void createIdentityMatrix(float* matrix) {
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+__attribute__((target("avx2")))
+static inline void bezierBasisAVX2(__m256 t, __m256* b, __m256* db) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+    t = _mm256_max_ps(_mm256_setzero_ps(), _mm256_min_ps(one, t));
+    __m256 s = _mm256_sub_ps(one, t);
+    
+    b[0] = _mm256_mul_ps(_mm256_mul_ps(s, s), s);
+    b[1] = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(three, s), s), t);
+    b[2] = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(three, s), t), t);
+    b[3] = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    
+    __m256 twoST = _mm256_mul_ps(_mm256_mul_ps(two, s), t);
+    db[0] = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(-3.0f), s), s);
+    db[1] = _mm256_mul_ps(three, _mm256_sub_ps(_mm256_mul_ps(s, s), twoST));
+    db[2] = _mm256_mul_ps(three, _mm256_sub_ps(twoST, _mm256_mul_ps(t, t)));
+    db[3] = _mm256_mul_ps(_mm256_mul_ps(three, t), t);
+}
+
+// 8 samples per iteration with AVX2 (no FMA, so results match the scalar path);
+// returns samples processed
+__attribute__((target("avx2")))
+size_t evaluatePatchBatchAVX2(const float* u, const float* v, size_t count, const PatchSampleOutputs& out) {
+    const float* cp = controlPoints.data();
+    size_t n = 0;
+    
+    for (; n + 8 <= count; n += 8) {
+        __m256 bu[4], dbu[4], bv[4], dbv[4];
+        bezierBasisAVX2(_mm256_loadu_ps(u + n), bu, dbu);
+        bezierBasisAVX2(_mm256_loadu_ps(v + n), bv, dbv);
+        
+        __m256 pos[3], du[3], dv[3];
+        for (int k = 0; k < 3; k++) {
+            pos[k] = du[k] = dv[k] = _mm256_setzero_ps();
+        }
+        
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                const float* p = cp + (i * 4 + j) * 3;
+                __m256 basis = _mm256_mul_ps(bu[i], bv[j]);
+                __m256 basisDu = _mm256_mul_ps(dbu[i], bv[j]);
+                __m256 basisDv = _mm256_mul_ps(bu[i], dbv[j]);
+                for (int k = 0; k < 3; k++) {
+                    __m256 c = _mm256_set1_ps(p[k]);
+                    pos[k] = _mm256_add_ps(pos[k], _mm256_mul_ps(c, basis));
+                    du[k] = _mm256_add_ps(du[k], _mm256_mul_ps(c, basisDu));
+                    dv[k] = _mm256_add_ps(dv[k], _mm256_mul_ps(c, basisDv));
+                }
+            }
+        }
+        
+        __m256 normal[3];
+        normal[0] = _mm256_sub_ps(_mm256_mul_ps(du[1], dv[2]), _mm256_mul_ps(du[2], dv[1]));
+        normal[1] = _mm256_sub_ps(_mm256_mul_ps(du[2], dv[0]), _mm256_mul_ps(du[0], dv[2]));
+        normal[2] = _mm256_sub_ps(_mm256_mul_ps(du[0], dv[1]), _mm256_mul_ps(du[1], dv[0]));
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(normal[0], normal[0]),
+                                                                _mm256_mul_ps(normal[1], normal[1])),
+                                                  _mm256_mul_ps(normal[2], normal[2])));
+        __m256 valid = _mm256_cmp_ps(len, _mm256_set1_ps(1e-6f), _CMP_GT_OQ);
+        for (int k = 0; k < 3; k++) {
+            normal[k] = _mm256_blendv_ps(normal[k], _mm256_div_ps(normal[k], len), valid);
+        }
+        
+        for (int k = 0; k < 3; k++) {
+            _mm256_storeu_ps(out.dst[k] + n, pos[k]);
+            _mm256_storeu_ps(out.dst[3 + k] + n, du[k]);
+            _mm256_storeu_ps(out.dst[6 + k] + n, dv[k]);
+            _mm256_storeu_ps(out.dst[9 + k] + n, normal[k]);
+        }
     }
+    return n;
 }
+#endif
 
-void createLookAtMatrix(float* matrix, float eyeX, float eyeY, float eyeZ,
-                       float centerX, float centerY, float centerZ,
-                       float upX, float upY, float upZ) {
-    float f[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
-    float len = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
-    if (len > 1e-6f) {
-        f[0] /= len; f[1] /= len; f[2] /= len;
+// Evaluate position, du, dv and unit normal at count (u, v) samples.
+// Dispatches to AVX2 (8 lanes) or SSE2 (4 lanes) per simdLevel; the tail is scalar.
+void evaluateBezierPatchBatch(const float* u, const float* v, size_t count, PatchSamples& samples) {
+    samples.resize(count);
+    PatchSampleOutputs out;
+    for (int k = 0; k < 3; k++) {
+        out.dst[k] = samples.position[k].data();
+        out.dst[3 + k] = samples.du[k].data();
+        out.dst[6 + k] = samples.dv[k].data();
+        out.dst[9 + k] = samples.normal[k].data();
     }
     
-    float s[3] = {
-        f[1] * upZ - f[2] * upY,
-        f[2] * upX - f[0] * upZ,
-        f[0] * upY - f[1] * upX
-    };
-    len = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
-    if (len > 1e-6f) {
-        s[0] /= len; s[1] /= len; s[2] /= len;
+    size_t n = 0;
+#if BEZIER_SIMD_X86
+    if (simdLevel == SIMD_AVX2) {
+        n = evaluatePatchBatchAVX2(u, v, count, out);
+    }
+    if (simdLevel >= SIMD_SSE2) {
+        PatchSampleOutputs rest = out;
+        for (int k = 0; k < 12; k++) {
+            rest.dst[k] += n;
+        }
+        n += evaluatePatchBatchSSE2(u + n, v + n, count - n, rest);
+    }
+#endif
+    for (; n < count; n++) {
+        evaluatePatchSampleScalar(u[n], v[n], out, n);
+    }
+}
+
+// SIMD tessellation of grid rows [rowBegin, rowEnd) through evaluateBezierPatchBatch
+void tessellatePatchBatchRows(int res, int rowBegin, int rowEnd, float* vertices) {
+    size_t count = (size_t)(rowEnd - rowBegin) * (res + 1);
+    std::vector<float> us(count), vs(count);
+    size_t n = 0;
+    for (int j = rowBegin; j < rowEnd; j++) {
+        for (int i = 0; i <= res; i++, n++) {
+            us[n] = (float)i / res;
+            vs[n] = (float)j / res;
+        }
     }
     
-    float u[3] = {
-        s[1] * f[2] - s[2] * f[1],
-        s[2] * f[0] - s[0] * f[2],
-        s[0] * f[1] - s[1] * f[0]
-    };
+    PatchSamples samples;
+    evaluateBezierPatchBatch(us.data(), vs.data(), count, samples);
     
-    createIdentityMatrix(matrix);
-    matrix[0] = s[0]; matrix[4] = s[1]; matrix[8] = s[2];
-    matrix[1] = u[0]; matrix[5] = u[1]; matrix[9] = u[2];
-    matrix[2] = -f[0]; matrix[6] = -f[1]; matrix[10] = -f[2];
-    matrix[12] = -(s[0]*eyeX + s[1]*eyeY + s[2]*eyeZ);
-    matrix[13] = -(u[0]*eyeX + u[1]*eyeY + u[2]*eyeZ);
-    matrix[14] = f[0]*eyeX + f[1]*eyeY + f[2]*eyeZ;
+    float* out = vertices + (size_t)rowBegin * (res + 1) * 6;
+    for (n = 0; n < count; n++) {
+        for (int k = 0; k < 3; k++) {
+            out[n * 6 + k] = samples.position[k][n];
+            out[n * 6 + 3 + k] = samples.normal[k][n];
+        }
+    }
+}
+
+void tessellatePatchBatch(int res, std::vector<float>& vertices) {
+    vertices.resize((size_t)(res + 1) * (res + 1) * 6);
+    tessellatePatchBatchRows(res, 0, res + 1, vertices.data());
+}
+
+// Generate indices for quad rows [rowBegin, rowEnd) of a (res+1) x (res+1)
+// vertex grid into a pre-sized index array (6 indices per quad)
+void generatePatchIndexRows(int res, int rowBegin, int rowEnd, unsigned int* indices) {
+    unsigned int* out = indices + (size_t)rowBegin * res * 6;
+    
+    for (int j = rowBegin; j < rowEnd; j++) {
+        for (int i = 0; i < res; i++) {
+            unsigned int topLeft = j * (res + 1) + i;
+            unsigned int topRight = topLeft + 1;
+            unsigned int bottomLeft = (j + 1) * (res + 1) + i;
+            unsigned int bottomRight = bottomLeft + 1;
+            
+            // First triangle
+            out[0] = topLeft;
+            out[1] = bottomLeft;
+            out[2] = topRight;
+            
+            // Second triangle
+            out[3] = topRight;
+            out[4] = bottomLeft;
+            out[5] = bottomRight;
+            out += 6;
+        }
+    }
+}
+
+void generatePatchIndices(int res, std::vector<unsigned int>& indices) {
+    indices.resize((size_t)res * res * 6);
+    generatePatchIndexRows(res, 0, res, indices.data());
 }
 
-void createPerspectiveMatrix(float* matrix, float fovy, float aspect, float near, float far) {
-    float f = 1.0f / tan(fovy * M_PI / 360.0f);
+// Tessellate the patch with the current evaluator, splitting vertex and
+// index rows into bands across the thread pool. Outputs are sized once
+// up front and each band writes only its own rows, so no locking is needed.
+// Indices depend only on res and are skipped when buildIndices is false.
+void tessellatePatchParallel(int res, std::vector<float>& vertices, std::vector<unsigned int>& indices,
+                             bool buildIndices = true) {
+    vertices.resize((size_t)(res + 1) * (res + 1) * 6);
+    if (buildIndices) {
+        indices.resize((size_t)res * res * 6);
+    }
+    if (evaluatorMode == EVAL_BASIS_TABLE) {
+        buildBasisTable(res, patchBasisTable);
+    }
     
-    createIdentityMatrix(matrix);
-    matrix[0] = f / aspect;
-    matrix[5] = f;
-    matrix[10] = (far + near) / (near - far);
-    matrix[11] = -1.0f;
-    matrix[14] = (2.0f * far * near) / (near - far);
-    matrix[15] = 0.0f;
+    float* vertexData = vertices.data();
+    unsigned int* indexData = indices.data();
+    EvaluatorMode mode = evaluatorMode;
+    int reseedInterval = forwardDiffReseedInterval;
+    const float* points = controlPoints.data();
+    
+    parallelRanges(res + 1, tessellationThreads, [=](int rowBegin, int rowEnd) {
+        if (mode == EVAL_FORWARD_DIFFERENCE) {
+            tessellatePatchForwardDifferenceRows(points, res, reseedInterval, false, rowBegin, rowEnd, vertexData);
+        } else if (mode == EVAL_SIMD_BATCH) {
+            tessellatePatchBatchRows(res, rowBegin, rowEnd, vertexData);
+        } else {
+            tessellatePatchRows(res, rowBegin, rowEnd, vertexData);
+        }
+        // Quad rows follow vertex rows; the last vertex row has no quads
+        if (buildIndices) {
+            generatePatchIndexRows(res, rowBegin, std::min(rowEnd, res), indexData);
+        }
+    });
 }
 
-void printInstructions() {
-    std::cout << "\n=== Bezier Patch - Interactive Control ===" << std::endl;
-    std::cout << "\nCONTROL POINT SELECTION:" << std::endl;
-    std::cout << "  0-9, A-F: Select control point (0-15)" << std::endl;
-    std::cout << "\nCONTROL POINT MODIFICATION:" << std::endl;
-    std::cout << "  X/x: Decrease/Increase X position" << std::endl;
-    std::cout << "  Y/y: Decrease/Increase Y position" << std::endl;
-    std::cout << "  Z/z: Decrease/Increase Z position" << std::endl;
-    std::cout << "\nTESSELLATION:" << std::endl;
-    std::cout << "  +/-: Decrease/Increase resolution" << std::endl;
-    std::cout << "\nCAMERA CONTROLS:" << std::endl;
-    std::cout << "  Arrow keys: Rotate camera" << std::endl;
-    std::cout << "  R/r: Reset view" << std::endl;
-    std::cout << "\nOTHER:" << std::endl;
-    std::cout << "  ESC: Exit" << std::endl;
-    std::cout << "\nCurrent selected point: " << selectedPoint << std::endl;
-    std::cout << "Current resolution: " << resolution << "x" << resolution << std::endl;
+// CPU copy of the current patch mesh, reused across regenerations
+std::vector<float> patchVertices;
+std::vector<unsigned int> patchIndices;
+
+// Delta engine state. The surface is linear in the control points, so moving
+// point (pi, pj) by delta adds delta * B_pi(u) B_pj(v) to every position, and
+// the matching derivative-basis terms to du and dv.
+std::vector<float> patchTangents;    // du xyz, dv xyz per vertex (6 floats)
+bool patchTangentsValid = false;
+int incrementalUpdates = 0;          // Deltas applied since the last full tessellation
+int incrementalRebuildInterval = 64; // Re-tessellate fully after this many deltas to drop drift
+
+// du and dv from the basis table for vertex rows [rowBegin, rowEnd)
+void computePatchTangentRows(int res, int rowBegin, int rowEnd, float* tangents) {
+    const float* basis = patchBasisTable.basis.data();
+    const float* dBasis = patchBasisTable.dBasis.data();
+    const float* cp = controlPoints.data();
+    float* out = tangents + (size_t)rowBegin * (res + 1) * 6;
+    
+    for (int j = rowBegin; j < rowEnd; j++) {
+        const float* bv = basis + j * 4;
+        const float* dbv = dBasis + j * 4;
+        for (int i = 0; i <= res; i++) {
+            const float* bu = basis + i * 4;
+            const float* dbu = dBasis + i * 4;
+            float du[3] = {0.0f, 0.0f, 0.0f};
+            float dv[3] = {0.0f, 0.0f, 0.0f};
+            for (int a = 0; a < 4; a++) {
+                for (int b = 0; b < 4; b++) {
+                    const float* p = cp + (a * 4 + b) * 3;
+                    float basisDu = dbu[a] * bv[b];
+                    float basisDv = bu[a] * dbv[b];
+                    for (int k = 0; k < 3; k++) {
+                        du[k] += p[k] * basisDu;
+                        dv[k] += p[k] * basisDv;
+                    }
+                }
+            }
+            for (int k = 0; k < 3; k++) {
+                out[k] = du[k];
+                out[3 + k] = dv[k];
+            }
+            out += 6;
+        }
+    }
 }
 
-void keyboard(unsigned char key, int x, int y) {
-    float delta = 0.1f;
+// Add the effect of moving control point `point` by delta[3] to vertices
+// (position + normal) and tangents in place. Returns the first and last
+// vertex rows that changed; rows where B_pj(v) and B'_pj(v) are both zero
+// are left untouched. firstRow > lastRow means nothing changed.
+void applyControlPointDelta(int res, int point, const float* delta,
+                            std::vector<float>& vertices, std::vector<float>& tangents,
+                            int& firstRow, int& lastRow) {
+    buildBasisTable(res, patchBasisTable);
+    int pi = point / 4;  // u index
+    int pj = point % 4;  // v index
+    const float* basis = patchBasisTable.basis.data();
+    const float* dBasis = patchBasisTable.dBasis.data();
+    
+    firstRow = res + 1;
+    lastRow = -1;
+    for (int j = 0; j <= res; j++) {
+        if (basis[j * 4 + pj] != 0.0f || dBasis[j * 4 + pj] != 0.0f) {
+            firstRow = std::min(firstRow, j);
+            lastRow = j;
+        }
+    }
+    if (firstRow > lastRow) {
+        return;
+    }
     
-    switch(key) {
-        // Control point selection
-        case '0': selectedPoint = 0; break;
-        case '1': selectedPoint = 1; break;
-        case '2': selectedPoint = 2; break;
-        case '3': selectedPoint = 3; break;
+    float* vertexData = vertices.data();
+    float* tangentData = tangents.data();
+    parallelRanges(lastRow - firstRow + 1, tessellationThreads, [=](int bandBegin, int bandEnd) {
+        for (int j = firstRow + bandBegin; j < firstRow + bandEnd; j++) {
+            float bv = basis[j * 4 + pj];
+            float dbv = dBasis[j * 4 + pj];
+            for (int i = 0; i <= res; i++) {
+                size_t n = (size_t)j * (res + 1) + i;
+                float* vertex = vertexData + n * 6;
+                float* du = tangentData + n * 6;
+                float* dv = du + 3;
+                float w = basis[i * 4 + pi] * bv;
+                float wDu = dBasis[i * 4 + pi] * bv;
+                float wDv = basis[i * 4 + pi] * dbv;
+                for (int k = 0; k < 3; k++) {
+                    vertex[k] += delta[k] * w;
+                    du[k] += delta[k] * wDu;
+                    dv[k] += delta[k] * wDv;
+                }
+                crossNormalize(du, dv, vertex + 3);
+            }
+        }
+    });
+}
+
+// Adaptive tessellation settings (T/t toggles, G/g scales the tolerance)
+bool adaptiveTessellation = false;
+float adaptiveTolerance = 1e-3f;  // Max distance between surface and a leaf's bilinear patch
+int adaptiveMinLevel = 2;         // Always subdivide at least to 4x4 cells
+int adaptiveMaxLevel = 10;        // Finest cells are 1/1024 of the domain
+
+// Basis and derivative-basis values at an arbitrary parameter t
+void bezierBasisValues(float t, float* b, float* db) {
+    t = std::max(0.0f, std::min(1.0f, t));
+    float oneMinusT = 1.0f - t;
+    for (int i = 0; i < 4; i++) {
+        b[i] = bezierBasis(i, t);
+    }
+    db[0] = -3.0f * oneMinusT * oneMinusT;
+    db[1] = 3.0f * (oneMinusT * oneMinusT - 2.0f * oneMinusT * t);
+    db[2] = 3.0f * (2.0f * oneMinusT * t - t * t);
+    db[3] = 3.0f * t * t;
+}
+
+// Position + normal at (u, v)
+void evaluatePatchPoint(float u, float v, float* out) {
+    float bu[4], dbu[4], bv[4], dbv[4];
+    bezierBasisValues(u, bu, dbu);
+    bezierBasisValues(v, bv, dbv);
+    evaluatePatchVertex(bu, dbu, bv, dbv, out);
+}
+
+// Quadtree cell over the (u, v) domain. x, y are in units of the cell size
+// (2^-level); children are -1 for leaves.
+struct AdaptiveCell {
+    int level;
+    int x, y;
+    int children[4];
+};
+
+struct AdaptiveMesh {
+    std::vector<float> vertices;       // position + normal (6 floats per vertex)
+    std::vector<float> params;         // u, v per vertex
+    std::vector<unsigned int> indices;
+};
+
+// Max distance between the surface and the cell's two triangles (split along
+// the same diagonal as the uniform grid), sampled on a 5x5 lattice
+float cellFlatnessError(float u0, float v0, float size) {
+    float c00[6], c10[6], c01[6], c11[6];
+    evaluatePatchPoint(u0, v0, c00);
+    evaluatePatchPoint(u0 + size, v0, c10);
+    evaluatePatchPoint(u0, v0 + size, c01);
+    evaluatePatchPoint(u0 + size, v0 + size, c11);
+    
+    float maxError = 0.0f;
+    for (int b = 0; b <= 4; b++) {
+        for (int a = 0; a <= 4; a++) {
+            if ((a == 0 || a == 4) && (b == 0 || b == 4)) {
+                continue;
+            }
+            float s = a * 0.25f;
+            float t = b * 0.25f;
+            float point[6];
+            evaluatePatchPoint(u0 + s * size, v0 + t * size, point);
+            
+            float error = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                float planar = (s + t <= 1.0f)
+                    ? c00[k] + s * (c10[k] - c00[k]) + t * (c01[k] - c00[k])
+                    : c11[k] + (1.0f - s) * (c01[k] - c11[k]) + (1.0f - t) * (c10[k] - c11[k]);
+                float d = point[k] - planar;
+                error += d * d;
+            }
+            maxError = std::max(maxError, error);
+        }
+    }
+    return sqrt(maxError);
+}
+
+void splitAdaptiveCell(std::vector<AdaptiveCell>& cells, int index) {
+    AdaptiveCell cell = cells[index];
+    for (int c = 0; c < 4; c++) {
+        AdaptiveCell child;
+        child.level = cell.level + 1;
+        child.x = cell.x * 2 + (c & 1);
+        child.y = cell.y * 2 + (c >> 1);
+        child.children[0] = child.children[1] = child.children[2] = child.children[3] = -1;
+        cells[index].children[c] = (int)cells.size();
+        cells.push_back(child);
+    }
+}
+
+// Leaf containing the point (px, py), given in units of the finest cell size
+int findAdaptiveLeaf(const std::vector<AdaptiveCell>& cells, int maxLevel, int px, int py) {
+    int index = 0;
+    while (cells[index].children[0] >= 0) {
+        int shift = maxLevel - cells[index].level - 1;
+        int c = ((px >> shift) & 1) | (((py >> shift) & 1) << 1);
+        index = cells[index].children[c];
+    }
+    return index;
+}
+
+// Build a crack-free adaptive triangulation. Cells are split while their
+// flatness error exceeds tolerance, then the quadtree is 2:1 balanced so every
+// edge has at most one hanging midpoint. Leaves with a finer neighbor are
+// triangulated as a fan around their center that includes the neighbor's
+// midpoint vertex; other leaves use two triangles like the uniform grid.
+void tessellatePatchAdaptive(float tolerance, int minLevel, int maxLevel, AdaptiveMesh& mesh) {
+    std::vector<AdaptiveCell> cells;
+    AdaptiveCell root = {0, 0, 0, {-1, -1, -1, -1}};
+    cells.push_back(root);
+    
+    // Refine by flatness (breadth-first; cells grows while iterating)
+    for (size_t n = 0; n < cells.size(); n++) {
+        AdaptiveCell cell = cells[n];
+        if (cell.level >= maxLevel) {
+            continue;
+        }
+        float size = 1.0f / (1 << cell.level);
+        if (cell.level < minLevel || cellFlatnessError(cell.x * size, cell.y * size, size) > tolerance) {
+            splitAdaptiveCell(cells, (int)n);
+        }
+    }
+    
+    // 2:1 balance: split any leaf more than one level coarser than a neighbor
+    int finest = 1 << maxLevel;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t n = 0; n < cells.size(); n++) {
+            if (cells[n].children[0] >= 0) {
+                continue;
+            }
+            int span = finest >> cells[n].level;
+            int x0 = cells[n].x * span;
+            int y0 = cells[n].y * span;
+            int probes[4][2] = {
+                {x0 - 1, y0}, {x0 + span, y0}, {x0, y0 - 1}, {x0, y0 + span}
+            };
+            for (int e = 0; e < 4; e++) {
+                int px = probes[e][0], py = probes[e][1];
+                if (px < 0 || py < 0 || px >= finest || py >= finest) {
+                    continue;
+                }
+                int neighbor = findAdaptiveLeaf(cells, maxLevel, px, py);
+                if (cells[neighbor].level < cells[n].level - 1) {
+                    splitAdaptiveCell(cells, neighbor);
+                    changed = true;
+                }
+            }
+        }
+    }
+    
+    // Emit vertices (shared through their finest-grid coordinates) and triangles
+    mesh.vertices.clear();
+    mesh.params.clear();
+    mesh.indices.clear();
+    std::unordered_map<unsigned long long, unsigned int> vertexIds;
+    auto vertexAt = [&](int gx, int gy) -> unsigned int {
+        unsigned long long key = (unsigned long long)gy * (finest + 1) + gx;
+        auto found = vertexIds.find(key);
+        if (found != vertexIds.end()) {
+            return found->second;
+        }
+        float u = (float)gx / finest;
+        float v = (float)gy / finest;
+        float vertex[6];
+        evaluatePatchPoint(u, v, vertex);
+        mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 6);
+        mesh.params.push_back(u);
+        mesh.params.push_back(v);
+        unsigned int id = (unsigned int)vertexIds.size();
+        vertexIds[key] = id;
+        return id;
+    };
+    
+    for (size_t n = 0; n < cells.size(); n++) {
+        const AdaptiveCell& cell = cells[n];
+        if (cell.children[0] >= 0) {
+            continue;
+        }
+        int span = finest >> cell.level;
+        int half = span / 2;
+        int x0 = cell.x * span, y0 = cell.y * span;
+        int x1 = x0 + span, y1 = y0 + span;
+        
+        // Hanging midpoints on edges shared with finer leaves
+        bool finerLeft = x0 > 0 && cells[findAdaptiveLeaf(cells, maxLevel, x0 - 1, y0)].level > cell.level;
+        bool finerTop = y1 < finest && cells[findAdaptiveLeaf(cells, maxLevel, x0, y1)].level > cell.level;
+        bool finerRight = x1 < finest && cells[findAdaptiveLeaf(cells, maxLevel, x1, y0)].level > cell.level;
+        bool finerBottom = y0 > 0 && cells[findAdaptiveLeaf(cells, maxLevel, x0, y0 - 1)].level > cell.level;
+        
+        if (!finerLeft && !finerTop && !finerRight && !finerBottom) {
+            unsigned int topLeft = vertexAt(x0, y0);
+            unsigned int topRight = vertexAt(x1, y0);
+            unsigned int bottomLeft = vertexAt(x0, y1);
+            unsigned int bottomRight = vertexAt(x1, y1);
+            unsigned int quad[6] = {topLeft, bottomLeft, topRight, topRight, bottomLeft, bottomRight};
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+            continue;
+        }
+        
+        // Boundary loop in the same winding as the uniform grid triangles
+        std::vector<unsigned int> loop;
+        loop.push_back(vertexAt(x0, y0));
+        if (finerLeft) loop.push_back(vertexAt(x0, y0 + half));
+        loop.push_back(vertexAt(x0, y1));
+        if (finerTop) loop.push_back(vertexAt(x0 + half, y1));
+        loop.push_back(vertexAt(x1, y1));
+        if (finerRight) loop.push_back(vertexAt(x1, y0 + half));
+        loop.push_back(vertexAt(x1, y0));
+        if (finerBottom) loop.push_back(vertexAt(x0 + half, y0));
+        
+        unsigned int center = vertexAt(x0 + half, y0 + half);
+        for (size_t k = 0; k < loop.size(); k++) {
+            mesh.indices.push_back(center);
+            mesh.indices.push_back(loop[k]);
+            mesh.indices.push_back(loop[(k + 1) % loop.size()]);
+        }
+    }
+}
+
+// Resolution whose indices are in patchEBO (-1 = none, adaptive or cached mesh)
+int uploadedIndexResolution = -1;
+int patchIndexCount = 0;
+int patchTriangleCount = 0;
+GLenum patchIndexType = GL_UNSIGNED_INT;  // GL_UNSIGNED_SHORT when the vertex count allows
+GLenum patchPrimitive = GL_TRIANGLES;     // GL_TRIANGLE_STRIP with primitive restart for grids
+bool triangleListsOnly = false;           // --triangle-lists: no strips even for grids
+
+// Uniform grids are drawn as strips (mesh_optimizer.h); adaptive meshes,
+// which are not grids, as triangle lists
+// Adaptive mode only applies to single-patch files; multi-patch surfaces
+// always tessellate uniformly
+bool adaptiveActive() {
+    return adaptiveTessellation && !multiPatch();
+}
+
+bool useStripIndices() {
+    return !triangleListsOnly && !adaptiveActive();
+}
+
+// patchVBO holds the compressed format (vertex_compression.h); the float
+// vertices stay on the CPU for the incremental update engine
+std::vector<uint16_t> patchPackedVertices;
+std::vector<uint16_t> patchPackedIndices;  // patchIndices as uploaded, when 16-bit
+MeshBounds patchBounds;
+
+// Position and normal attributes of the bound patch VAO
+void setPatchVertexAttributes() {
+    GLsizei stride = compressedVertexShorts(false) * sizeof(uint16_t);
+    
+    // Position attribute (unorm16, decoded with patchBounds)
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)COMPRESSED_POSITION_OFFSET);
+    glEnableVertexAttribArray(0);
+    
+    // Normal attribute (octahedral snorm16)
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)COMPRESSED_NORMAL_OFFSET);
+    glEnableVertexAttribArray(1);
+}
+
+// Compress position + normal vertices, splitting large meshes into blocks
+// across the thread pool
+MeshBounds compressPatchVertices(const float* vertices, size_t count, std::vector<uint16_t>& packed) {
+    MeshBounds bounds = computeMeshBounds(vertices, count, 6);
+    int shorts = compressedVertexShorts(false);
+    packed.resize(count * shorts);
+    
+    const size_t block = 16384;
+    uint16_t* packedData = packed.data();
+    parallelRanges((int)((count + block - 1) / block), tessellationThreads, [=](int blockBegin, int blockEnd) {
+        size_t first = blockBegin * block;
+        size_t last = std::min(count, blockEnd * block);
+        compressVertices(vertices + first * 6, last - first, 6, bounds, packedData + first * shorts);
+    });
+    return bounds;
+}
+
+// Compress a whole float mesh into patchVBO, reallocating it when the
+// vertex count changes
+void uploadPatchVertices(const float* vertices, size_t count, bool reallocate) {
+    patchBounds = compressPatchVertices(vertices, count, patchPackedVertices);
+    size_t bytes = patchPackedVertices.size() * sizeof(uint16_t);
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    if (reallocate) {
+        glBufferData(GL_ARRAY_BUFFER, bytes, patchPackedVertices.data(), GL_DYNAMIC_DRAW);
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, patchPackedVertices.data());
+    }
+}
+
+// Re-compress and upload patchVertices [first, first + count). If an edit
+// moved one of them outside patchBounds, the whole mesh is re-quantized.
+void uploadPatchVertexRange(size_t first, size_t count) {
+    const float* vertices = patchVertices.data() + first * 6;
+    if (!meshBoundsContain(patchBounds, vertices, count, 6)) {
+        uploadPatchVertices(patchVertices.data(), patchVertices.size() / 6, false);
+        return;
+    }
+    
+    int shorts = compressedVertexShorts(false);
+    uint16_t* packed = patchPackedVertices.data() + first * shorts;
+    compressVertices(vertices, count, 6, patchBounds, packed);
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, first * shorts * sizeof(uint16_t), count * shorts * sizeof(uint16_t), packed);
+}
+
+// Upload 16- or 32-bit indices (indexBytes) for patchPrimitive into the
+// bound VAO's patchEBO and set the matching restart index
+void uploadPatchIndexBlob(const void* indices, size_t indexCount, size_t indexBytes) {
+    bool sixteenBit = (indexBytes == sizeof(uint16_t));
+    patchIndexCount = (int)indexCount;
+    patchIndexType = sixteenBit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (patchPrimitive != GL_TRIANGLE_STRIP) {
+        patchTriangleCount = (int)(indexCount / 3);
+    } else if (sixteenBit) {
+        patchTriangleCount = (int)countStripTriangles((const uint16_t*)indices, indexCount);
+    } else {
+        patchTriangleCount = (int)countStripTriangles((const unsigned int*)indices, indexCount);
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexBytes, indices, GL_STATIC_DRAW);
+    glPrimitiveRestartIndex(stripRestartIndex(sixteenBit));
+}
+
+// Upload indices for patchPrimitive, as 16-bit when the vertex count allows
+// (kept in patchPackedIndices for the mesh cache)
+void uploadPatchIndices(const unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    if (indicesFit16(vertexCount)) {
+        packIndices16(indices, indexCount, patchPackedIndices);
+        uploadPatchIndexBlob(patchPackedIndices.data(), indexCount, sizeof(uint16_t));
+    } else {
+        patchPackedIndices.clear();
+        uploadPatchIndexBlob(indices, indexCount, sizeof(unsigned int));
+    }
+}
+
+// Tessellate and upload the patch mesh. report prints the vertex cache and
+// compression statistics (used at startup).
+void generatePatchMesh(bool report = false) {
+    std::vector<float>& vertices = patchVertices;
+    std::vector<unsigned int>& indices = patchIndices;
+    bool resolutionChanged = (resolution != uploadedIndexResolution);
+    bool strips = useStripIndices();
+    bool buildTriangles = resolutionChanged && !strips;
+    
+    if (multiPatch()) {
+        // All patches into one shared buffer; the evaluator and adaptive
+        // modes apply to single-patch files only
+        surface.setPatch(activePatch, controlPoints.data());
+        tessellateBezierSurface(surface, resolution, false, tessellationThreads, vertices, indices, buildTriangles);
+    } else if (adaptiveTessellation) {
+        AdaptiveMesh adaptive;
+        tessellatePatchAdaptive(adaptiveTolerance, adaptiveMinLevel, adaptiveMaxLevel, adaptive);
+        vertices.swap(adaptive.vertices);
+        indices.swap(adaptive.indices);
+        resolutionChanged = true;
+    } else {
+        tessellatePatchParallel(resolution, vertices, indices, buildTriangles);
+    }
+    patchTangentsValid = false;
+    incrementalUpdates = 0;
+    cpuMeshStale = false;
+    
+    // Update VAO, VBO, EBO
+    if (patchVAO == 0) {
+        glGenVertexArrays(1, &patchVAO);
+        glGenBuffers(1, &patchVBO);
+        glGenBuffers(1, &patchEBO);
+    }
+    
+    glBindVertexArray(patchVAO);
+    
+    // Reallocate storage only when the vertex count changes
+    uploadPatchVertices(vertices.data(), vertices.size() / 6, resolutionChanged);
+    
+    // The index buffer depends only on resolution. Grids become cache-sized
+    // strip bands; triangle lists are reordered for the vertex cache.
+    // Vertices keep the grid layout the incremental engine updates by rows.
+    if (resolutionChanged) {
+        size_t vertexCount = vertices.size() / 6;
+        patchPrimitive = strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+        if (strips) {
+            generateGridStripBlocks(multiPatch() ? surface.patchCount() : 1, resolution, resolution, indices);
+            if (report) {
+                printStripStats("patch mesh", indices.data(), indices.size(), vertexCount);
+            }
+        } else {
+            optimizeMesh("patch mesh", nullptr, vertexCount, 6, indices, report);
+        }
+        uploadPatchIndices(indices.data(), indices.size(), vertexCount);
+        uploadedIndexResolution = adaptiveActive() ? -1 : resolution;
+    }
+    if (report) {
+        printCompressionStats("patch mesh", measureCompression(vertices.data(), vertices.size() / 6, 6,
+                                                                patchBounds, patchPackedVertices.data()));
+    }
+    
+    setPatchVertexAttributes();
+    glBindVertexArray(0);
+}
+
+// Key for the startup mesh cache: everything generatePatchMesh depends on
+uint64_t patchMeshCacheKey() {
+    uint64_t key = meshCacheHashValue(MESH_CACHE_HASH_SEED, resolution);
+    key = meshCacheHashValue(key, adaptiveActive());
+    key = meshCacheHashValue(key, useStripIndices());
+    if (adaptiveActive()) {
+        key = meshCacheHashValue(key, adaptiveTolerance);
+        key = meshCacheHashValue(key, adaptiveMinLevel);
+        key = meshCacheHashValue(key, adaptiveMaxLevel);
+    }
+    if (multiPatch()) {
+        key = meshCacheHash(key, surface.x.data(), surface.x.size() * sizeof(float));
+        key = meshCacheHash(key, surface.y.data(), surface.y.size() * sizeof(float));
+        key = meshCacheHash(key, surface.z.data(), surface.z.size() * sizeof(float));
+    } else {
+        key = meshCacheHashValue(key, (int)evaluatorMode);
+        key = meshCacheHashValue(key, forwardDiffReseedInterval);
+        key = meshCacheHash(key, controlPoints.data(), controlPoints.size() * sizeof(float));
+    }
+    return key;
+}
+
+// Build the initial mesh, uploading the compressed vertices and indices
+// straight from a mapped cache file when one exists. On a hit patchVertices
+// stays empty; the first edit then re-tessellates in full, since the delta
+// engine needs the CPU copy.
+void loadPatchMesh() {
+    if (!meshCacheEnabled) {
+        generatePatchMesh(true);
+        return;
+    }
+    
+    size_t vertexBytes = compressedVertexShorts(false) * sizeof(uint16_t);
+    uint64_t key = patchMeshCacheKey();
+    std::string path = meshCachePath(meshCacheDir, "bezier", key);
+    MappedMesh cached;
+    if (!mapMeshCache(path, key, vertexBytes, cached)) {
+        generatePatchMesh(true);
+        bool sixteenBit = (patchIndexType == GL_UNSIGNED_SHORT);
+        MeshLayout layout = {(uint16_t)vertexBytes, (uint16_t)(sixteenBit ? sizeof(uint16_t) : sizeof(unsigned int))};
+        writeMeshCache(path, key, layout, patchBounds, patchPackedVertices.data(), patchVertices.size() / 6,
+                       sixteenBit ? (const void*)patchPackedIndices.data() : (const void*)patchIndices.data(),
+                       patchIndices.size());
+        return;
+    }
+    
+    glGenVertexArrays(1, &patchVAO);
+    glGenBuffers(1, &patchVBO);
+    glGenBuffers(1, &patchEBO);
+    glBindVertexArray(patchVAO);
+    patchBounds = cached.bounds;
+    glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
+    glBufferData(GL_ARRAY_BUFFER, cached.vertexCount * vertexBytes, cached.vertices, GL_DYNAMIC_DRAW);
+    patchPrimitive = useStripIndices() ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+    uploadPatchIndexBlob(cached.indices, cached.indexCount, cached.layout.indexBytes);
+    setPatchVertexAttributes();
+    glBindVertexArray(0);
+    
+    patchVertices.clear();
+    patchIndices.clear();
+    uploadedIndexResolution = -1;
+    std::cout << "Loaded mesh from cache: " << path << std::endl;
+    unmapMeshCache(cached);
+}
+
+// Move the selected control point along one axis and update the mesh in place,
+// streaming only the changed vertex rows to the VBO
+void moveControlPoint(int axis, float amount) {
+    controlPoints[selectedPoint * 3 + axis] += amount;
+    
+    // The GPU path reads the control point buffer directly; the CPU mesh is
+    // rebuilt if the CPU path is selected again
+    if (gpuTessellation) {
+        if (multiPatch()) {
+            surface.setPatch(activePatch, controlPoints.data());
+        }
+        cpuMeshStale = true;
+        return;
+    }
+    
+    // Multi-patch surface: re-tessellate and upload only the active patch's block
+    if (multiPatch() && patchVAO != 0 && uploadedIndexResolution == resolution) {
+        surface.setPatch(activePatch, controlPoints.data());
+        size_t patchFloats = (size_t)(resolution + 1) * (resolution + 1) * 6;
+        float* block = patchVertices.data() + activePatch * patchFloats;
+        tessellateSurfacePatch(surface, activePatch, resolution, false, block);
+        uploadPatchVertexRange(activePatch * patchFloats / 6, patchFloats / 6);
+        return;
+    }
+    
+    if (patchVAO == 0 || adaptiveActive() || uploadedIndexResolution != resolution ||
+        incrementalUpdates >= incrementalRebuildInterval) {
+        generatePatchMesh();
+        return;
+    }
+    
+    // Tangents are only needed by the delta engine; build them on the first
+    // edit from the control points patchVertices was built from, since the
+    // delta below is applied to both
+    if (!patchTangentsValid) {
+        controlPoints[selectedPoint * 3 + axis] -= amount;
+        buildBasisTable(resolution, patchBasisTable);
+        patchTangents.resize(patchVertices.size());
+        int res = resolution;
+        float* tangentData = patchTangents.data();
+        parallelRanges(res + 1, tessellationThreads, [=](int rowBegin, int rowEnd) {
+            computePatchTangentRows(res, rowBegin, rowEnd, tangentData);
+        });
+        patchTangentsValid = true;
+        controlPoints[selectedPoint * 3 + axis] += amount;
+    }
+    
+    float delta[3] = {0.0f, 0.0f, 0.0f};
+    delta[axis] = amount;
+    int firstRow, lastRow;
+    applyControlPointDelta(resolution, selectedPoint, delta, patchVertices, patchTangents, firstRow, lastRow);
+    incrementalUpdates++;
+    if (firstRow > lastRow) {
+        return;
+    }
+    
+    size_t rowVertices = (size_t)(resolution + 1);
+    uploadPatchVertexRange(firstRow * rowVertices, (lastRow - firstRow + 1) * rowVertices);
+}
+
+// Index of a control point of the active patch in the marker buffer
+int controlPointVertex(int point) {
+    return (multiPatch() ? activePatch * 16 : 0) + point;
+}
+
+// Build the marker buffer for every patch's control points. Called at
+// startup and on patch switches, which change every point's size.
+void generateControlPoints() {
+    int patches = std::max(1, surface.patchCount());
+    std::vector<ControlPointVertex> vertices(patches * 16);
+    
+    for (int p = 0; p < patches; p++) {
+        bool active = !multiPatch() || p == activePatch;
+        for (int k = 0; k < 16; k++) {
+            ControlPointVertex& vertex = vertices[p * 16 + k];
+            if (active) {
+                vertex.position[0] = controlPoints[k * 3 + 0];
+                vertex.position[1] = controlPoints[k * 3 + 1];
+                vertex.position[2] = controlPoints[k * 3 + 2];
+            } else {
+                vertex.position[0] = surface.x[p * 16 + k];
+                vertex.position[1] = surface.y[p * 16 + k];
+                vertex.position[2] = surface.z[p * 16 + k];
+            }
+            vertex.size = active ? ACTIVE_POINT_SIZE : INACTIVE_POINT_SIZE;
+            vertex.selected = 0;
+            vertex.padding[0] = vertex.padding[1] = vertex.padding[2] = 0;
+        }
+    }
+    highlightedVertex = controlPointVertex(selectedPoint);
+    vertices[highlightedVertex].selected = 1;
+    
+    if (controlPointsVAO == 0) {
+        glGenVertexArrays(1, &controlPointsVAO);
+        glGenBuffers(1, &controlPointsVBO);
+    }
+    
+    glBindVertexArray(controlPointsVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ControlPointVertex), vertices.data(), GL_DYNAMIC_DRAW);
+    
+    GLsizei stride = sizeof(ControlPointVertex);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ControlPointVertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(ControlPointVertex, size));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 1, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(ControlPointVertex, selected));
+    glEnableVertexAttribArray(2);
+    
+    glBindVertexArray(0);
+}
+
+// Move the highlight to selectedPoint: one byte cleared, one byte set
+void updateControlPointHighlight() {
+    int vertex = controlPointVertex(selectedPoint);
+    if (vertex == highlightedVertex) {
+        return;
+    }
+    
+    unsigned char off = 0, on = 1;
+    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, highlightedVertex * sizeof(ControlPointVertex) + offsetof(ControlPointVertex, selected),
+                    1, &off);
+    glBufferSubData(GL_ARRAY_BUFFER, vertex * sizeof(ControlPointVertex) + offsetof(ControlPointVertex, selected),
+                    1, &on);
+    highlightedVertex = vertex;
+}
+
+// Re-upload the selected point's position after a move
+void updateControlPointPosition() {
+    int vertex = controlPointVertex(selectedPoint);
+    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, vertex * sizeof(ControlPointVertex) + offsetof(ControlPointVertex, position),
+                    3 * sizeof(float), &controlPoints[selectedPoint * 3]);
+}
+
+unsigned int compileShader(unsigned int type, const char* source) {
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[512];
+        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
+    }
+    
+    return shader;
+}
+
+// Patch VAO for the GPU path over the marker buffer's positions, so control
+// point edits need no upload beyond updateControlPointPosition
+void generateTessellationPatches() {
+    if (tessPatchVAO == 0) {
+        glGenVertexArrays(1, &tessPatchVAO);
+    }
+    
+    glBindVertexArray(tessPatchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, controlPointsVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ControlPointVertex), (void*)offsetof(ControlPointVertex, position));
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
+
+// Compile and link the tessellation program; false if the driver rejects it
+bool createTessellationProgram() {
+    std::vector<unsigned int> shaders;
+    shaders.push_back(compileShader(GL_VERTEX_SHADER, bezierTessVertexShaderSource));
+    shaders.push_back(compileShader(GL_TESS_CONTROL_SHADER, bezierTessControlShaderSource));
+    shaders.push_back(compileShader(GL_TESS_EVALUATION_SHADER, bezierTessEvaluationShaderSource));
+    shaders.push_back(compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource));
+    bool linked = tessShaderProgram.link(shaders);
+    for (size_t i = 0; i < shaders.size(); i++) {
+        glDeleteShader(shaders[i]);
+    }
+    if (!linked) {
+        return false;
+    }
+    
+    tess.model = tessShaderProgram.location("model");
+    tess.objectColor = tessShaderProgram.location("objectColor");
+    tess.ka = tessShaderProgram.location("ka");
+    tess.kd = tessShaderProgram.location("kd");
+    tess.ks = tessShaderProgram.location("ks");
+    tess.shininess = tessShaderProgram.location("shininess");
+    tess.viewportSize = tessShaderProgram.location("viewportSize");
+    tess.pixelsPerSegment = tessShaderProgram.location("pixelsPerSegment");
+    tess.maxTessLevel = tessShaderProgram.location("maxTessLevel");
+    
+    int maxLevel = 64;
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+    maxTessLevel = std::min(maxTessLevel, (float)maxLevel);
+    return true;
+}
+
+// Generate axes (positions only, colors set in shader)
+void generateAxes() {
+    float vertices[] = {
+        // X axis
+        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin with dummy normal
+        0.5f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // X end with dummy normal
+        // Y axis
+        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin
+        0.0f, 0.5f, 0.0f,  0.0f, 0.0f, 1.0f,  // Y end
+        // Z axis
+        0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f,  // origin
+        0.0f, 0.0f, 0.5f,  0.0f, 0.0f, 1.0f   // Z end
+    };
+    
+    if (axesVAO == 0) {
+        glGenVertexArrays(1, &axesVAO);
+        glGenBuffers(1, &axesVBO);
+    }
+    
+    glBindVertexArray(axesVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, axesVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    
+    // Drawn with positionMin = 0, positionScale = 1; the first two normal
+    // floats (0, 0) are the octahedral encoding of the dummy +z normal
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    
+    glBindVertexArray(0);
+}
+
+void printInstructions() {
+    std::cout << "\n=== Bezier Patch - Interactive Control ===" << std::endl;
+    std::cout << "\nCONTROL POINT SELECTION:" << std::endl;
+    std::cout << "  0-9, A-F: Select control point (0-15)" << std::endl;
+    std::cout << "  [/]: Previous/Next patch (multi-patch files)" << std::endl;
+    std::cout << "\nCONTROL POINT MODIFICATION:" << std::endl;
+    std::cout << "  X/x: Decrease/Increase X position" << std::endl;
+    std::cout << "  Y/y: Decrease/Increase Y position" << std::endl;
+    std::cout << "  Z/z: Decrease/Increase Z position" << std::endl;
+    std::cout << "\nTESSELLATION:" << std::endl;
+    std::cout << "  +/-: Decrease/Increase resolution" << std::endl;
+    std::cout << "  </>: Halve/Double resolution (max " << maxResolution << ")" << std::endl;
+    std::cout << "  T/t: Toggle uniform / adaptive tessellation" << std::endl;
+    std::cout << "  G/g: Coarser/Finer adaptive tolerance" << std::endl;
+    std::cout << "  M/m: Cycle evaluator (basis table / forward differencing / SIMD batch)" << std::endl;
+    std::cout << "  N/n: Decrease/Increase forward-differencing re-seed interval" << std::endl;
+    std::cout << "  H/h: Toggle CPU / GPU (tessellation shader) path" << std::endl;
+    std::cout << "\nCAMERA CONTROLS:" << std::endl;
+    std::cout << "  Arrow keys: Rotate camera" << std::endl;
+    std::cout << "  R/r: Reset view" << std::endl;
+    std::cout << "\nOTHER:" << std::endl;
+    std::cout << "  ESC: Exit" << std::endl;
+    std::cout << "\nCurrent selected point: " << selectedPoint << std::endl;
+    std::cout << "Current resolution: " << resolution << "x" << resolution << std::endl;
+    std::cout << "Patches: " << std::max(1, surface.patchCount()) << std::endl;
+    std::cout << "Tessellation threads: " << tessellationThreads << std::endl;
+}
+
+void keyboard(unsigned char key, int x, int y) {
+    float delta = 0.1f;
+    
+    switch(key) {
+        // Patch selection (multi-patch files)
+        case '[':
+        case ']':
+            if (multiPatch()) {
+                surface.setPatch(activePatch, controlPoints.data());
+                int count = surface.patchCount();
+                activePatch = (activePatch + (key == ']' ? 1 : count - 1)) % count;
+                surface.getPatch(activePatch, controlPoints.data());
+                generateControlPoints();
+                std::cout << "Active patch: " << activePatch << " of " << count << std::endl;
+            }
+            break;
+        
+        // Control point selection
+        case '0': selectedPoint = 0; break;
+        case '1': selectedPoint = 1; break;
+        case '2': selectedPoint = 2; break;
+        case '3': selectedPoint = 3; break;
         case '4': selectedPoint = 4; break;
         case '5': selectedPoint = 5; break;
         case '6': selectedPoint = 6; break;
@@ -476,40 +1788,46 @@ void keyboard(unsigned char key, int x, int y) {
         
         // Control point modification
         case 'x':
-            controlPoints[selectedPoint * 3 + 0] += delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(0, delta);
+            updateControlPointPosition();
             break;
         case 'X':
-            controlPoints[selectedPoint * 3 + 0] -= delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(0, -delta);
+            updateControlPointPosition();
             break;
         case 'y':
-            controlPoints[selectedPoint * 3 + 1] += delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(1, delta);
+            updateControlPointPosition();
             break;
         case 'Y':
-            controlPoints[selectedPoint * 3 + 1] -= delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(1, -delta);
+            updateControlPointPosition();
             break;
         case 'z':
-            controlPoints[selectedPoint * 3 + 2] += delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(2, delta);
+            updateControlPointPosition();
             break;
         case 'Z':
-            controlPoints[selectedPoint * 3 + 2] -= delta;
-            generatePatchMesh();
-            generateControlPoints();
+            moveControlPoint(2, -delta);
+            updateControlPointPosition();
             break;
         
         // Tessellation
         case '+':
         case '=':
-            resolution = std::min(50, resolution + 1);
+            resolution = std::min(maxResolution, resolution + 1);
+            generatePatchMesh();
+            std::cout << "Resolution: " << resolution << "x" << resolution << std::endl;
+            break;
+        case '>':
+        case '.':
+            resolution = std::min(maxResolution, resolution * 2);
+            generatePatchMesh();
+            std::cout << "Resolution: " << resolution << "x" << resolution << std::endl;
+            break;
+        case '<':
+        case ',':
+            resolution = std::max(3, resolution / 2);
             generatePatchMesh();
             std::cout << "Resolution: " << resolution << "x" << resolution << std::endl;
             break;
@@ -520,6 +1838,76 @@ void keyboard(unsigned char key, int x, int y) {
             std::cout << "Resolution: " << resolution << "x" << resolution << std::endl;
             break;
         
+        // Adaptive tessellation
+        case 't':
+        case 'T':
+            if (multiPatch()) {
+                std::cout << "Adaptive tessellation applies to single-patch files only" << std::endl;
+                break;
+            }
+            adaptiveTessellation = !adaptiveTessellation;
+            generatePatchMesh();
+            std::cout << "Tessellation: " << (adaptiveTessellation ? "adaptive" : "uniform")
+                      << " (" << patchTriangleCount << " triangles)" << std::endl;
+            break;
+        case 'g':
+        case 'G':
+            if (multiPatch()) {
+                std::cout << "Adaptive tessellation applies to single-patch files only" << std::endl;
+                break;
+            }
+            adaptiveTolerance *= (key == 'g') ? 0.5f : 2.0f;
+            adaptiveTolerance = std::max(1e-6f, std::min(0.5f, adaptiveTolerance));
+            generatePatchMesh();
+            std::cout << "Adaptive tolerance: " << adaptiveTolerance
+                      << " (" << patchTriangleCount << " triangles)" << std::endl;
+            break;
+        
+        // Evaluator mode
+        case 'm':
+        case 'M':
+            if (multiPatch()) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            evaluatorMode = (EvaluatorMode)((evaluatorMode + 1) % 3);
+            generatePatchMesh();
+            std::cout << "Evaluator: " << evaluatorModeName(evaluatorMode) << std::endl;
+            break;
+        case 'n':
+            if (multiPatch()) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            forwardDiffReseedInterval = (forwardDiffReseedInterval == 0) ? 1 : std::min(1024, forwardDiffReseedInterval * 2);
+            generatePatchMesh();
+            std::cout << "Forward-differencing re-seed interval: " << forwardDiffReseedInterval << std::endl;
+            break;
+        case 'N':
+            if (multiPatch()) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            forwardDiffReseedInterval /= 2;
+            generatePatchMesh();
+            std::cout << "Forward-differencing re-seed interval: " << forwardDiffReseedInterval
+                      << (forwardDiffReseedInterval == 0 ? " (never)" : "") << std::endl;
+            break;
+        
+        // CPU / GPU tessellation path
+        case 'h':
+        case 'H':
+            if (!gpuTessellationSupported) {
+                std::cout << "GPU tessellation needs OpenGL 4.0 tessellation shaders" << std::endl;
+                break;
+            }
+            gpuTessellation = !gpuTessellation;
+            if (!gpuTessellation && cpuMeshStale) {
+                generatePatchMesh();
+            }
+            std::cout << "Tessellation path: " << (gpuTessellation ? "GPU (screen-space adaptive)" : "CPU") << std::endl;
+            break;
+        
         // Reset view
         case 'r':
         case 'R':
@@ -535,6 +1923,7 @@ void keyboard(unsigned char key, int x, int y) {
     }
     
     if ((key >= '0' && key <= '9') || (key >= 'a' && key <= 'f') || (key >= 'A' && key <= 'F')) {
+        updateControlPointHighlight();
         std::cout << "Selected control point: " << selectedPoint << std::endl;
     }
     
@@ -571,68 +1960,76 @@ void display() {
     float camZ = cameraTargetZ + cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
     
     // Matrices
-    float model[16], view[16], projection[16];
-    createIdentityMatrix(model);
-    createLookAtMatrix(view, camX, camY, camZ, cameraTargetX, cameraTargetY, cameraTargetZ, 0.0f, 1.0f, 0.0f);
-    createPerspectiveMatrix(projection, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
-    
-    glUseProgram(shaderProgram);
-    
-    // Set matrices
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
-    
-    // Set light and material properties
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), lightPos[0], lightPos[1], lightPos[2]);
-    glUniform3f(glGetUniformLocation(shaderProgram, "viewPos"), camX, camY, camZ);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-    glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.2f, 0.6f, 0.8f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderProgram, "shininess"), shininess);
+    Mat4 model = Mat4::identity();
+    Mat4 view = Mat4::lookAt(Vec3{camX, camY, camZ}, Vec3{cameraTargetX, cameraTargetY, cameraTargetZ}, Vec3{0.0f, 1.0f, 0.0f});
+    Mat4 projection = Mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    
+    // Camera and light for this frame
+    FrameUniforms frame;
+    float viewPos[3] = {camX, camY, camZ};
+    float lightColor[3] = {1.0f, 1.0f, 1.0f};
+    setFrameUniforms(frame, view.m, projection.m, lightPos, viewPos, lightColor);
+    frameUniforms.update(frame);
     
     // Draw patch
-    glBindVertexArray(patchVAO);
-    int numIndices = resolution * resolution * 6;
-    glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
+    if (gpuTessellation) {
+        tessShaderProgram.use();
+        tessShaderProgram.setMat4(tess.model, model.m);
+        tessShaderProgram.setVec3(tess.objectColor, 0.2f, 0.6f, 0.8f);
+        tessShaderProgram.setFloat(tess.ka, ka);
+        tessShaderProgram.setFloat(tess.kd, kd);
+        tessShaderProgram.setFloat(tess.ks, ks);
+        tessShaderProgram.setFloat(tess.shininess, shininess);
+        tessShaderProgram.setVec2(tess.viewportSize, (float)windowWidth, (float)windowHeight);
+        tessShaderProgram.setFloat(tess.pixelsPerSegment, tessPixelsPerSegment);
+        tessShaderProgram.setFloat(tess.maxTessLevel, maxTessLevel);
+        
+        glPatchParameteri(GL_PATCH_VERTICES, 16);
+        glBindVertexArray(tessPatchVAO);
+        glDrawArrays(GL_PATCHES, 0, std::max(1, surface.patchCount()) * 16);
+    } else {
+        shaderProgram.use();
+        
+        // Model matrix and material (uploaded only when they change)
+        shaderProgram.setMat4(phong.model, model.m);
+        shaderProgram.setVec3(phong.objectColor, 0.2f, 0.6f, 0.8f);
+        shaderProgram.setFloat(phong.ka, ka);
+        shaderProgram.setFloat(phong.kd, kd);
+        shaderProgram.setFloat(phong.ks, ks);
+        shaderProgram.setFloat(phong.shininess, shininess);
+        shaderProgram.setVec3(phong.positionMin, patchBounds.min[0], patchBounds.min[1], patchBounds.min[2]);
+        shaderProgram.setVec3(phong.positionScale, patchBounds.scale[0], patchBounds.scale[1], patchBounds.scale[2]);
+        
+        glBindVertexArray(patchVAO);
+        glDrawElements(patchPrimitive, patchIndexCount, patchIndexType, 0);
+    }
     
-    // Draw control points with simple rendering
+    // Draw every control point in one call; size and color are per vertex
     glDisable(GL_DEPTH_TEST);
+    pointShaderProgram.use();
+    pointShaderProgram.setMat4(pointModelLocation, model.m);
     glBindVertexArray(controlPointsVAO);
-    glPointSize(10.0f);
-    for (int i = 0; i < 16; i++) {
-        if (i == selectedPoint) {
-            glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 1.0f, 1.0f, 0.0f); // Yellow for selected
-            glPointSize(12.0f);
-        } else {
-            glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 1.0f, 0.0f, 0.0f); // Red for others
-            glPointSize(8.0f);
-        }
-        glDrawArrays(GL_POINTS, i, 1);
-    }
+    glDrawArrays(GL_POINTS, 0, std::max(1, surface.patchCount()) * 16);
     glEnable(GL_DEPTH_TEST);
     
     // Draw axes (X=red, Y=green, Z=blue) with flat shading
+    shaderProgram.use();
+    shaderProgram.setVec3(phong.positionMin, 0.0f, 0.0f, 0.0f);
+    shaderProgram.setVec3(phong.positionScale, 1.0f, 1.0f, 1.0f);
     glBindVertexArray(axesVAO);
     glLineWidth(3.0f);
     // X axis (red)
-    glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 1.0f, 0.0f, 0.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), 1.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), 0.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), 0.0f);
+    shaderProgram.setVec3(phong.objectColor, 1.0f, 0.0f, 0.0f);
+    shaderProgram.setFloat(phong.ka, 1.0f);
+    shaderProgram.setFloat(phong.kd, 0.0f);
+    shaderProgram.setFloat(phong.ks, 0.0f);
     glDrawArrays(GL_LINES, 0, 2);
     // Y axis (green)
-    glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.0f, 1.0f, 0.0f);
+    shaderProgram.setVec3(phong.objectColor, 0.0f, 1.0f, 0.0f);
     glDrawArrays(GL_LINES, 2, 2);
     // Z axis (blue)
-    glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.0f, 0.0f, 1.0f);
+    shaderProgram.setVec3(phong.objectColor, 0.0f, 0.0f, 1.0f);
     glDrawArrays(GL_LINES, 4, 2);
-    // Restore lighting
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), ks);
     
     glBindVertexArray(0);
     
@@ -640,25 +2037,11 @@ void display() {
 }
 
 void reshape(int width, int height) {
+    windowWidth = width;
+    windowHeight = height;
     glViewport(0, 0, width, height);
 }
 
-unsigned int compileShader(unsigned int type, const char* source) {
-    unsigned int shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, nullptr);
-    glCompileShader(shader);
-    
-    int success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetShaderInfoLog(shader, 512, nullptr, infoLog);
-        std::cerr << "Shader compilation failed: " << infoLog << std::endl;
-    }
-    
-    return shader;
-}
-
 void init() {
     GLenum err = glewInit();
     if (err != GLEW_OK) {
@@ -673,32 +2056,709 @@ void init() {
     unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
     unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
     
-    // Create shader program
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
-    int success;
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        char infoLog[512];
-        glGetProgramInfoLog(shaderProgram, 512, nullptr, infoLog);
-        std::cerr << "Shader program linking failed: " << infoLog << std::endl;
-    }
+    // Create shader program and resolve its uniforms
+    shaderProgram.link(vertexShader, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
     
+    phong.model = shaderProgram.location("model");
+    phong.objectColor = shaderProgram.location("objectColor");
+    phong.ka = shaderProgram.location("ka");
+    phong.kd = shaderProgram.location("kd");
+    phong.ks = shaderProgram.location("ks");
+    phong.shininess = shaderProgram.location("shininess");
+    phong.positionMin = shaderProgram.location("positionMin");
+    phong.positionScale = shaderProgram.location("positionScale");
+    
+    // Control point marker program; gl_PointSize comes from the vertex shader
+    vertexShader = compileShader(GL_VERTEX_SHADER, pointVertexShaderSource);
+    fragmentShader = compileShader(GL_FRAGMENT_SHADER, pointFragmentShaderSource);
+    pointShaderProgram.link(vertexShader, fragmentShader);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+    pointModelLocation = pointShaderProgram.location("model");
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_PRIMITIVE_RESTART);  // Restart index is set with the strip indices
+    
+    frameUniforms.create();
+    
+    // Control points from file; keep the built-in patch if loading fails
+    if (loadBezierSurface(patchFile, surface)) {
+        surface.getPatch(activePatch, controlPoints.data());
+        std::cout << "Loaded " << surface.patchCount() << " patch(es) from " << patchFile << std::endl;
+    } else {
+        surface.clear();
+    }
+    
+    // Hardware tessellation path; the CPU path stays the fallback
+    if (GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader) {
+        gpuTessellationSupported = createTessellationProgram();
+    }
+    if (gpuTessellation && !gpuTessellationSupported) {
+        std::cerr << "GPU tessellation unavailable, using the CPU path" << std::endl;
+        gpuTessellation = false;
+    }
     
     // Generate geometry
-    generatePatchMesh();
+    loadPatchMesh();
     generateControlPoints();
+    generateTessellationPatches();
     generateAxes();
     
     printInstructions();
 }
 
+// Compare reference and table-driven tessellation (run with --benchmark)
+void benchmarkTessellation() {
+    std::cout << "\n=== Tessellation: per-sample evaluators vs basis table ===" << std::endl;
+    
+    int resolutions[] = {10, 64, 256, 512};
+    for (int res : resolutions) {
+        std::vector<float> reference, table;
+        int iterations = res <= 64 ? 50 : 3;
+        
+        double referenceMs = timeMilliseconds(iterations, [&]() { tessellatePatchReference(res, reference); });
+        patchBasisTable = BasisTable();
+        double tableMs = timeMilliseconds(iterations, [&]() { tessellatePatch(res, table); });
+        
+        bool identical = reference.size() == table.size() &&
+                         memcmp(reference.data(), table.data(), reference.size() * sizeof(float)) == 0;
+        
+        std::cout << "  " << res << "x" << res
+                  << ": reference " << referenceMs << " ms"
+                  << ", table " << tableMs << " ms"
+                  << ", speedup " << referenceMs / tableMs << "x"
+                  << ", bit-identical: " << (identical ? "yes" : "NO") << std::endl;
+    }
+}
+
+// Forward differencing accuracy and speed against the basis-table evaluator
+void benchmarkForwardDifference() {
+    int resolutions[] = {64, 256, 1024};
+    benchmarkForwardDifference(controlPoints.data(), false, resolutions, 3, "basis table",
+                               [](int res, std::vector<float>& vertices) { tessellatePatch(res, vertices); });
+}
+
+// Batch evaluation per instruction set against the scalar basis-table path
+void benchmarkSimdBatch() {
+    SimdLevel detected = detectSimdLevel();
+    std::cout << "\n=== SIMD batch evaluation (detected: " << simdLevelName(detected) << ") ===" << std::endl;
+    
+    int resolutions[] = {64, 256, 512};
+    for (int res : resolutions) {
+        std::vector<float> table, batch;
+        int iterations = res <= 64 ? 50 : 5;
+        double tableMs = timeMilliseconds(iterations, [&]() { tessellatePatch(res, table); });
+        std::cout << "  " << res << "x" << res << ": basis table " << tableMs << " ms" << std::endl;
+        
+        for (int level = SIMD_SCALAR; level <= detected; level++) {
+            simdLevel = (SimdLevel)level;
+            double batchMs = timeMilliseconds(iterations, [&]() { tessellatePatchBatch(res, batch); });
+            bool identical = memcmp(table.data(), batch.data(), table.size() * sizeof(float)) == 0;
+            std::cout << "    " << simdLevelName(simdLevel) << " batch " << batchMs << " ms"
+                      << ", speedup " << tableMs / batchMs << "x"
+                      << ", bit-identical: " << (identical ? "yes" : "NO") << std::endl;
+        }
+    }
+    simdLevel = detected;
+}
+
+// Row-band parallel tessellation against a single thread
+void benchmarkParallelTessellation() {
+    std::cout << "\n=== Parallel tessellation (" << std::thread::hardware_concurrency() << " hardware threads) ===" << std::endl;
+    
+    int savedThreads = tessellationThreads;
+    int resolutions[] = {512, 1024, 2048};
+    for (int res : resolutions) {
+        std::vector<float> serialVertices, vertices;
+        std::vector<unsigned int> serialIndices, indices;
+        
+        tessellationThreads = 1;
+        double serialMs = timeMilliseconds(3, [&]() { tessellatePatchParallel(res, serialVertices, serialIndices); });
+        std::cout << "  " << res << "x" << res << " (" << serialVertices.size() / 6 << " vertices): 1 thread "
+                  << serialMs << " ms" << std::endl;
+        
+        for (int threads = 2; threads <= (int)std::max(2u, std::thread::hardware_concurrency()); threads *= 2) {
+            tessellationThreads = threads;
+            double ms = timeMilliseconds(3, [&]() { tessellatePatchParallel(res, vertices, indices); });
+            bool identical = vertices == serialVertices && indices == serialIndices;
+            std::cout << "    " << threads << " threads " << ms << " ms, speedup " << serialMs / ms << "x"
+                      << ", identical: " << (identical ? "yes" : "NO") << std::endl;
+        }
+    }
+    tessellationThreads = savedThreads;
+}
+
+// Delta updates against full re-tessellation, and drift after many deltas
+void benchmarkIncrementalUpdate() {
+    std::cout << "\n=== Incremental update: control point delta vs full re-tessellation ===" << std::endl;
+    
+    std::vector<float> savedControlPoints = controlPoints;
+    EvaluatorMode savedMode = evaluatorMode;
+    evaluatorMode = EVAL_BASIS_TABLE;
+    
+    int resolutions[] = {256, 1024};
+    for (int res : resolutions) {
+        std::vector<float> vertices, tangents, reference;
+        std::vector<unsigned int> indices;
+        controlPoints = savedControlPoints;
+        
+        double fullMs = timeMilliseconds(3, [&]() { tessellatePatchParallel(res, vertices, indices, false); });
+        buildBasisTable(res, patchBasisTable);
+        tangents.resize(vertices.size());
+        computePatchTangentRows(res, 0, res + 1, tangents.data());
+        
+        // 64 edits cycling over all control points and axes
+        int edits = 64;
+        int firstRow = 0, lastRow = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int e = 0; e < edits; e++) {
+            int point = (e * 7) % 16;
+            float delta[3] = {0.0f, 0.0f, 0.0f};
+            delta[e % 3] = (e % 2 == 0) ? 0.1f : -0.05f;
+            for (int k = 0; k < 3; k++) {
+                controlPoints[point * 3 + k] += delta[k];
+            }
+            applyControlPointDelta(res, point, delta, vertices, tangents, firstRow, lastRow);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        double deltaMs = std::chrono::duration<double, std::milli>(end - start).count() / edits;
+        
+        tessellatePatch(res, reference);
+        float maxPosition, maxNormal;
+        maxDeviation(reference, vertices, 6, maxPosition, maxNormal);
+        
+        std::cout << "  " << res << "x" << res << ": full " << fullMs << " ms, delta " << deltaMs
+                  << " ms (" << fullMs / deltaMs << "x); after " << edits << " deltas: position "
+                  << maxPosition << ", normal " << maxNormal << std::endl;
+    }
+    
+    controlPoints = savedControlPoints;
+    evaluatorMode = savedMode;
+}
+
+// Max distance between a triangle mesh and the true surface, measured at the
+// samples x samples parameter grid: each sample is located in its triangle
+// in (u, v) space and the triangle's linear interpolation is compared with the
+// exact surface point
+float meshGeometricError(const std::vector<float>& vertices, const std::vector<float>& params,
+                         const std::vector<unsigned int>& indices, int samples) {
+    std::vector<float> exact;
+    tessellatePatch(samples, exact);
+    
+    float maxError = 0.0f;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        const float* p[3];
+        const float* uv[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = &vertices[indices[t + k] * 6];
+            uv[k] = &params[indices[t + k] * 2];
+        }
+        float det = (uv[1][0] - uv[0][0]) * (uv[2][1] - uv[0][1]) - (uv[2][0] - uv[0][0]) * (uv[1][1] - uv[0][1]);
+        if (fabs(det) < 1e-12f) {
+            continue;
+        }
+        
+        float minU = std::min(uv[0][0], std::min(uv[1][0], uv[2][0]));
+        float maxU = std::max(uv[0][0], std::max(uv[1][0], uv[2][0]));
+        float minV = std::min(uv[0][1], std::min(uv[1][1], uv[2][1]));
+        float maxV = std::max(uv[0][1], std::max(uv[1][1], uv[2][1]));
+        for (int sj = (int)ceil(minV * samples); sj <= (int)floor(maxV * samples); sj++) {
+            for (int si = (int)ceil(minU * samples); si <= (int)floor(maxU * samples); si++) {
+                float u = (float)si / samples;
+                float v = (float)sj / samples;
+                float b1 = ((u - uv[0][0]) * (uv[2][1] - uv[0][1]) - (uv[2][0] - uv[0][0]) * (v - uv[0][1])) / det;
+                float b2 = ((uv[1][0] - uv[0][0]) * (v - uv[0][1]) - (u - uv[0][0]) * (uv[1][1] - uv[0][1])) / det;
+                float b0 = 1.0f - b1 - b2;
+                if (b0 < -1e-5f || b1 < -1e-5f || b2 < -1e-5f) {
+                    continue;
+                }
+                
+                const float* surface = &exact[((size_t)sj * (samples + 1) + si) * 6];
+                float error = 0.0f;
+                for (int k = 0; k < 3; k++) {
+                    float d = b0 * p[0][k] + b1 * p[1][k] + b2 * p[2][k] - surface[k];
+                    error += d * d;
+                }
+                maxError = std::max(maxError, (float)sqrt(error));
+            }
+        }
+    }
+    return maxError;
+}
+
+// Triangle count versus max geometric error for uniform and adaptive meshes
+void benchmarkAdaptiveTessellation() {
+    std::cout << "\n=== Adaptive tessellation: triangles vs max geometric error ===" << std::endl;
+    const int samples = 512;
+    
+    // The default net bends everywhere; the second is flat apart from one
+    // lifted corner, which is where adaptive refinement pays off
+    std::vector<float> savedControlPoints = controlPoints;
+    std::vector<float> liftedCorner = controlPoints;
+    for (int p = 0; p < 16; p++) {
+        liftedCorner[p * 3 + 2] = 0.0f;
+    }
+    liftedCorner[15 * 3 + 2] = 1.5f;
+    
+    for (int net = 0; net < 2; net++) {
+        controlPoints = (net == 0) ? savedControlPoints : liftedCorner;
+        std::cout << (net == 0 ? "  Default control net" : "  Flat net with lifted corner") << std::endl;
+        
+        int resolutions[] = {8, 16, 32, 64, 128, 256};
+        for (int res : resolutions) {
+            std::vector<float> vertices, params;
+            std::vector<unsigned int> indices;
+            tessellatePatch(res, vertices);
+            generatePatchIndices(res, indices);
+            for (int j = 0; j <= res; j++) {
+                for (int i = 0; i <= res; i++) {
+                    params.push_back((float)i / res);
+                    params.push_back((float)j / res);
+                }
+            }
+            std::cout << "    uniform " << res << "x" << res << ": " << indices.size() / 3
+                      << " triangles, max error " << meshGeometricError(vertices, params, indices, samples) << std::endl;
+        }
+        
+        float tolerances[] = {1e-2f, 3e-3f, 1e-3f, 3e-4f, 1e-4f};
+        for (float tolerance : tolerances) {
+            AdaptiveMesh mesh;
+            double ms = timeMilliseconds(1, [&]() {
+                tessellatePatchAdaptive(tolerance, adaptiveMinLevel, adaptiveMaxLevel, mesh);
+            });
+            std::cout << "    adaptive " << tolerance << ": " << mesh.indices.size() / 3 << " triangles, max error "
+                      << meshGeometricError(mesh.vertices, mesh.params, mesh.indices, samples)
+                      << " (" << ms << " ms)" << std::endl;
+        }
+    }
+    controlPoints = savedControlPoints;
+}
+
+// 64x64 copies of the current patch, side by side
+void buildTiledSurface(BezierSurface& tiled) {
+    float patch[48];
+    for (int ty = 0; ty < 64; ty++) {
+        for (int tx = 0; tx < 64; tx++) {
+            for (int k = 0; k < 16; k++) {
+                patch[k * 3 + 0] = controlPoints[k * 3 + 0] + tx * 3.0f;
+                patch[k * 3 + 1] = controlPoints[k * 3 + 1] + ty * 3.0f;
+                patch[k * 3 + 2] = controlPoints[k * 3 + 2];
+            }
+            tiled.addPatch(patch);
+        }
+    }
+}
+
+// Multi-patch tessellation of a large synthetic surface (a 64x64 tiling of
+// the control net) into one shared buffer
+void benchmarkMultiPatchSurface() {
+    std::cout << "\n=== Multi-patch surface ===" << std::endl;
+    
+    BezierSurface tiled;
+    buildTiledSurface(tiled);
+    
+    std::vector<int> threadCounts(1, 1);
+    if (std::thread::hardware_concurrency() > 1) {
+        threadCounts.push_back((int)std::thread::hardware_concurrency());
+    }
+    int resolutions[] = {8, 16, 32};
+    for (int res : resolutions) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        for (int threads : threadCounts) {
+            double ms = timeMilliseconds(3, [&]() {
+                tessellateBezierSurface(tiled, res, false, threads, vertices, indices);
+            });
+            std::cout << "  " << tiled.patchCount() << " patches at " << res << "x" << res << ": "
+                      << vertices.size() / 6 << " vertices, " << indices.size() / 3 << " triangles, "
+                      << threads << " thread(s) " << ms << " ms" << std::endl;
+        }
+    }
+}
+
+// Generating and compressing the tiled surface vs mapping it back from the
+// mesh cache. The mapped load touches every page, as glBufferData would.
+void benchmarkMeshCache() {
+    std::cout << "\n=== Mesh cache ===" << std::endl;
+    
+    BezierSurface tiled;
+    buildTiledSurface(tiled);
+    size_t vertexBytes = compressedVertexShorts(false) * sizeof(uint16_t);
+    
+    int resolutions[] = {8, 32};
+    for (int res : resolutions) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<uint16_t> packedVertices, packedIndices;
+        MeshBounds bounds;
+        bool sixteenBit = false;
+        double generateMs = timeMilliseconds(3, [&]() {
+            tessellateBezierSurface(tiled, res, false, tessellationThreads, vertices, indices);
+            bounds = compressPatchVertices(vertices.data(), vertices.size() / 6, packedVertices);
+            sixteenBit = indicesFit16(vertices.size() / 6);
+            if (sixteenBit) {
+                packIndices16(indices.data(), indices.size(), packedIndices);
+            }
+        });
+        const void* indexData = sixteenBit ? (const void*)packedIndices.data() : (const void*)indices.data();
+        MeshLayout layout = {(uint16_t)vertexBytes, (uint16_t)(sixteenBit ? sizeof(uint16_t) : sizeof(unsigned int))};
+        size_t vertexBlob = packedVertices.size() * sizeof(uint16_t);
+        size_t indexBlob = indices.size() * layout.indexBytes;
+        
+        uint64_t key = meshCacheHashValue(MESH_CACHE_HASH_SEED, res);
+        std::string path = meshCachePath(meshCacheDir, "benchmark", key);
+        auto writeStart = std::chrono::high_resolution_clock::now();
+        if (!writeMeshCache(path, key, layout, bounds, packedVertices.data(), vertices.size() / 6,
+                            indexData, indices.size())) {
+            return;
+        }
+        double writeMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - writeStart).count();
+        
+        unsigned int checksum = 0;
+        double mapMs = timeMilliseconds(3, [&]() {
+            MappedMesh cached;
+            if (mapMeshCache(path, key, vertexBytes, cached)) {
+                const uint16_t* data = cached.vertices;
+                for (size_t i = 0; i < cached.vertexCount * vertexBytes / sizeof(uint16_t); i += 2048) {
+                    checksum += data[i];
+                }
+                unmapMeshCache(cached);
+            }
+        });
+        
+        MappedMesh cached;
+        bool identical = mapMeshCache(path, key, vertexBytes, cached) &&
+                         cached.vertexCount * vertexBytes == vertexBlob && cached.indexCount == indices.size() &&
+                         memcmp(&cached.bounds, &bounds, sizeof(MeshBounds)) == 0 &&
+                         memcmp(cached.vertices, packedVertices.data(), vertexBlob) == 0 &&
+                         memcmp(cached.indices, indexData, indexBlob) == 0;
+        unmapMeshCache(cached);
+        remove(path.c_str());
+        
+        std::cout << "  " << tiled.patchCount() << " patches at " << res << "x" << res << " ("
+                  << (vertexBlob + indexBlob) / (1024 * 1024) << " MB, " << layout.indexBytes * 8
+                  << "-bit indices): generate " << generateMs << " ms, write " << writeMs << " ms, mapped load "
+                  << mapMs << " ms, " << (identical ? "identical" : "MISMATCH")
+                  << " (checksum " << checksum << ")" << std::endl;
+    }
+}
+
+// simd_math.h kernels against the scalar reference on random matrices.
+// Products and transforms run over cache-sized blocks (passes x block) so the
+// timings measure arithmetic rather than memory bandwidth.
+void benchmarkMatrixMath() {
+    std::cout << "\n=== Matrix math (simd_math.h) ===" << std::endl;
+    
+    const size_t count = 1 << 20;
+    const size_t block = 4096;
+    const size_t passes = count / block;
+    std::vector<Mat4> a(count), b(count), scalar(count), batch(count);
+    srand(1);
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < 16; k++) {
+            a[i].m[k] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+            b[i].m[k] = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+        }
+    }
+    
+    double scalarMs = timeMilliseconds(3, [&]() {
+        for (size_t pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < block; i++) {
+                multiplyMat4Scalar(a[i], b[i], scalar[i]);
+            }
+        }
+    });
+    double batchMs = timeMilliseconds(3, [&]() {
+        for (size_t pass = 0; pass < passes; pass++) {
+            multiplyMat4Batch(a.data(), b.data(), batch.data(), block);
+        }
+    });
+    bool identical = memcmp(scalar.data(), batch.data(), block * sizeof(Mat4)) == 0;
+    std::cout << "  " << count << " multiplies: scalar " << scalarMs << " ms, SIMD " << batchMs << " ms, speedup "
+              << scalarMs / batchMs << "x, bit-identical: " << (identical ? "yes" : "NO") << std::endl;
+    
+    const size_t pointCount = 4 * count;
+    std::vector<Vec4> points(4 * block), scalarPoints(4 * block), batchPoints(4 * block);
+    for (size_t i = 0; i < 4 * block; i++) {
+        points[i] = Vec4{rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, rand() / (float)RAND_MAX, 1.0f};
+    }
+    Mat4 transform = Mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f) *
+                     Mat4::lookAt(Vec3{3.0f, 2.0f, 5.0f}, Vec3{0.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f});
+    scalarMs = timeMilliseconds(3, [&]() {
+        for (size_t pass = 0; pass < passes; pass++) {
+            for (size_t i = 0; i < 4 * block; i++) {
+                scalarPoints[i] = transformVec4Scalar(transform, points[i]);
+            }
+        }
+    });
+    batchMs = timeMilliseconds(3, [&]() {
+        for (size_t pass = 0; pass < passes; pass++) {
+            transformVec4Batch(transform, points.data(), batchPoints.data(), 4 * block);
+        }
+    });
+    identical = memcmp(scalarPoints.data(), batchPoints.data(), 4 * block * sizeof(Vec4)) == 0;
+    std::cout << "  " << pointCount << " point transforms: scalar " << scalarMs << " ms, SIMD " << batchMs
+              << " ms, speedup " << scalarMs / batchMs << "x, bit-identical: " << (identical ? "yes" : "NO")
+              << std::endl;
+    
+    // Inverses of affine model matrices, checked through M * inverse(M) = I
+    for (size_t i = 0; i < count; i++) {
+        a[i] = Mat4::translation(a[i].m[0], a[i].m[1], a[i].m[2]) * Mat4::rotationY(a[i].m[3] * 180.0f) *
+               Mat4::rotationX(a[i].m[4] * 180.0f) * Mat4::scale(1.5f + a[i].m[5], 1.5f + a[i].m[6], 1.5f + a[i].m[7]);
+    }
+    scalarMs = timeMilliseconds(3, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            inverseScalar(a[i], scalar[i]);
+        }
+    });
+    batchMs = timeMilliseconds(3, [&]() {
+        for (size_t i = 0; i < count; i++) {
+            batch[i] = inverse(a[i]);
+        }
+    });
+    float maxError = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        Mat4 product = a[i] * batch[i];
+        for (int k = 0; k < 16; k++) {
+            maxError = std::max(maxError, fabsf(product.m[k] - ((k % 5 == 0) ? 1.0f : 0.0f)));
+        }
+    }
+    std::cout << "  " << count << " inverses: Gauss-Jordan " << scalarMs << " ms, SIMD " << batchMs
+              << " ms, speedup " << scalarMs / batchMs << "x, max |M * inverse(M) - I| " << maxError << std::endl;
+}
+
+// Compact vertex format (vertex_compression.h): size, error and packing time
+void benchmarkVertexCompression() {
+    std::cout << "\n=== Vertex compression (24 -> 12 bytes per vertex) ===" << std::endl;
+    
+    BezierSurface tiled;
+    buildTiledSurface(tiled);
+    
+    int resolutions[] = {8, 32};
+    for (int res : resolutions) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        tessellateBezierSurface(tiled, res, false, tessellationThreads, vertices, indices, false);
+        
+        size_t count = vertices.size() / 6;
+        std::vector<uint16_t> packed;
+        MeshBounds bounds;
+        double serialMs = timeMilliseconds(3, [&]() {
+            bounds = compressMesh("surface", vertices.data(), count, 6, packed, false);
+        });
+        double parallelMs = timeMilliseconds(3, [&]() {
+            bounds = compressPatchVertices(vertices.data(), count, packed);
+        });
+        CompressionStats stats = measureCompression(vertices.data(), count, 6, bounds, packed.data());
+        float extent = std::max(bounds.scale[0], std::max(bounds.scale[1], bounds.scale[2]));
+        std::cout << "  " << tiled.patchCount() << " patches at " << res << "x" << res << ": "
+                  << stats.rawBytes / 1024 << " KB -> " << stats.compressedBytes / 1024 << " KB, pack "
+                  << serialMs << " ms (1 thread) / " << parallelMs << " ms (" << tessellationThreads
+                  << " threads), max position error " << stats.maxPositionError << " (extent " << extent
+                  << "), max normal error " << stats.maxNormalError << " deg" << std::endl;
+    }
+}
+
+void benchmarkVertexCache() {
+    std::cout << "\n=== Vertex cache optimization (" << VERTEX_CACHE_SIZE << "-entry FIFO) ===" << std::endl;
+    
+    BezierSurface single;
+    single.addPatch(controlPoints.data());
+    BezierSurface tiled;
+    buildTiledSurface(tiled);
+    
+    struct Case {
+        const char* name;
+        const BezierSurface* surface;
+        int resolution;
+    };
+    Case cases[] = {{"1 patch", &single, 16}, {"1 patch", &single, 64}, {"1 patch", &single, 256},
+                    {"tiled", &tiled, 8}};
+    for (const Case& c : cases) {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        tessellateBezierSurface(*c.surface, c.resolution, false, tessellationThreads, vertices, indices);
+        size_t vertexCount = vertices.size() / 6;
+        
+        VertexCacheStats before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+        std::vector<unsigned int> optimized;
+        double optimizeMs = timeMilliseconds(3, [&]() {
+            optimized = indices;
+            optimizeVertexCache(optimized.data(), optimized.size(), vertexCount);
+        });
+        VertexCacheStats after = analyzeVertexCache(optimized.data(), optimized.size(), vertexCount);
+        size_t indexBytes = indices.size() * (indicesFit16(vertexCount) ? sizeof(uint16_t) : sizeof(unsigned int));
+        std::cout << "  " << c.name << " at " << c.resolution << "x" << c.resolution << " (" << vertexCount
+                  << " vertices): ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr
+                  << " -> " << after.atvr << ", " << optimizeMs << " ms, indices "
+                  << indices.size() * sizeof(unsigned int) / 1024 << " -> " << indexBytes / 1024 << " KB"
+                  << std::endl;
+    }
+}
+
+// Index bytes and vertex cache behavior of strips against optimized lists
+void benchmarkStripIndices() {
+    std::cout << "\n=== Triangle strips with primitive restart vs triangle lists ===" << std::endl;
+    
+    int resolutions[] = {16, 64, 256, 1024};
+    for (int res : resolutions) {
+        size_t vertexCount = (size_t)(res + 1) * (res + 1);
+        std::vector<unsigned int> lists;
+        generatePatchIndices(res, lists);
+        optimizeVertexCache(lists.data(), lists.size(), vertexCount);
+        std::vector<unsigned int> strips;
+        double stripMs = timeMilliseconds(3, [&]() { generateGridStripBlocks(1, res, res, strips); });
+        
+        VertexCacheStats listStats = analyzeVertexCache(lists.data(), lists.size(), vertexCount);
+        VertexCacheStats stripStats = analyzeVertexCacheStrips(strips.data(), strips.size(), vertexCount);
+        size_t listBytes = lists.size() * (indicesFit16(vertexCount) ? 2 : 4);
+        size_t stripBytes = strips.size() * (indicesFit16(vertexCount) ? 2 : 4);
+        std::cout << "  " << res << "x" << res << ": lists " << lists.size() << " indices / " << listBytes / 1024.0
+                  << " KB, ACMR " << listStats.acmr << "; strips " << strips.size() << " indices / "
+                  << stripBytes / 1024.0 << " KB, ACMR " << stripStats.acmr << " (" << stripMs
+                  << " ms); " << (double)listBytes / stripBytes << "x fewer index bytes" << std::endl;
+    }
+}
+
+// Parametric meshes (parametric_mesh.h) against a torus that calls sin/cos
+// per vertex, the way part 3b used to build it
+void benchmarkParametricMeshes() {
+    std::cout << "\n=== Parametric meshes: sin/cos tables vs per-vertex trig ===" << std::endl;
+    
+    ParametricParams torus = defaultParametricParams(SHAPE_TORUS);
+    torus.columns = 1024;
+    torus.rows = 1024;
+    std::vector<float> reference(parametricVertexCount(torus) * 6);
+    double referenceMs = timeMilliseconds(3, [&]() {
+        float* out = reference.data();
+        for (int i = 0; i <= torus.rows; i++) {
+            float u = (float)i / torus.rows * 2.0f * M_PI;
+            for (int j = 0; j <= torus.columns; j++, out += 6) {
+                float v = (float)j / torus.columns * 2.0f * M_PI;
+                float ring = torus.radius + torus.minorRadius * cos(v);
+                writeParametricVertex(out, ring * cos(u), ring * sin(u), torus.minorRadius * sin(v),
+                                      cos(v) * cos(u), cos(v) * sin(u), sin(v));
+            }
+        }
+    });
+    std::vector<float> vertices(reference.size());
+    double tableMs = timeMilliseconds(3, [&]() { generateParametricVertices(torus, 1, vertices.data()); });
+    float maxDiff = 0.0f;
+    for (size_t k = 0; k < vertices.size(); k++) {
+        maxDiff = std::max(maxDiff, std::fabs(vertices[k] - reference[k]));
+    }
+    std::cout << "  torus 1024x1024 vertices: per-vertex trig " << referenceMs << " ms, tables " << tableMs
+              << " ms (1 thread), max difference " << maxDiff << std::endl;
+    
+    std::vector<unsigned int> indices;
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        ParametricParams params = defaultParametricParams((ParametricShape)shape);
+        params.columns = 2048;
+        params.rows = 1024;
+        generateParametricMesh(params, tessellationThreads, vertices, indices);  // Size the arrays once
+        double ms = timeMilliseconds(3, [&]() {
+            generateParametricMesh(params, tessellationThreads, vertices, indices);
+        });
+        std::cout << "  " << parametricShapeName(params.shape) << " 2048x1024: "
+                  << countStripTriangles(indices.data(), indices.size()) << " triangles in " << ms << " ms ("
+                  << tessellationThreads << " threads)" << std::endl;
+    }
+}
+
+// Draw time of the patch mesh as strips and as triangle lists. Needs a GL
+// context, so it runs after init() (--draw-benchmark) rather than with the
+// CPU benchmarks.
+void benchmarkIndexModes() {
+    std::cout << "\n=== Draw time: triangle strips vs triangle lists ===" << std::endl;
+    
+    bool savedTriangleListsOnly = triangleListsOnly;
+    int savedResolution = resolution;
+    display();  // Frame uniforms and material for the patch program
+    
+    const int draws = 100;
+    int resolutions[] = {16, 64, 256};
+    for (int res : resolutions) {
+        resolution = res;
+        for (int lists = 0; lists < 2; lists++) {
+            triangleListsOnly = (lists == 1);
+            uploadedIndexResolution = -1;
+            generatePatchMesh();
+            
+            shaderProgram.use();
+            glBindVertexArray(patchVAO);
+            glFinish();
+            double ms = timeMilliseconds(1, [&]() {
+                for (int n = 0; n < draws; n++) {
+                    glDrawElements(patchPrimitive, patchIndexCount, patchIndexType, 0);
+                }
+                glFinish();
+            }) / draws;
+            size_t indexBytes = patchIndexCount * (patchIndexType == GL_UNSIGNED_SHORT ? 2 : 4);
+            std::cout << "  " << res << "x" << res << (lists ? " lists:  " : " strips: ") << patchIndexCount
+                      << " indices, " << indexBytes / 1024.0 << " KB, " << ms << " ms per draw" << std::endl;
+        }
+    }
+    glBindVertexArray(0);
+    
+    triangleListsOnly = savedTriangleListsOnly;
+    resolution = savedResolution;
+    uploadedIndexResolution = -1;
+    generatePatchMesh();
+}
+
+void runBenchmarks() {
+    benchmarkTessellation();
+    benchmarkForwardDifference();
+    benchmarkSimdBatch();
+    benchmarkParallelTessellation();
+    benchmarkIncrementalUpdate();
+    benchmarkAdaptiveTessellation();
+    benchmarkMultiPatchSurface();
+    benchmarkMeshCache();
+    benchmarkMatrixMath();
+    benchmarkVertexCompression();
+    benchmarkVertexCache();
+    benchmarkStripIndices();
+    benchmarkParametricMeshes();
+}
+
 int main(int argc, char** argv) {
+    bool benchmark = false;
+    bool drawBenchmark = false;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--benchmark") {
+            benchmark = true;
+        } else if (arg == "--max-resolution" && a + 1 < argc) {
+            maxResolution = std::max(3, atoi(argv[++a]));
+        } else if (arg == "--threads" && a + 1 < argc) {
+            tessellationThreads = std::max(1, atoi(argv[++a]));
+        } else if (arg == "--patches" && a + 1 < argc) {
+            patchFile = argv[++a];
+        } else if (arg == "--resolution" && a + 1 < argc) {
+            resolution = std::max(3, atoi(argv[++a]));
+        } else if (arg == "--no-mesh-cache") {
+            meshCacheEnabled = false;
+        } else if (arg == "--gpu-tessellation") {
+            gpuTessellation = true;
+        } else if (arg == "--tess-pixels" && a + 1 < argc) {
+            tessPixelsPerSegment = std::max(1.0f, (float)atof(argv[++a]));
+        } else if (arg == "--triangle-lists") {
+            triangleListsOnly = true;
+        } else if (arg == "--draw-benchmark") {
+            drawBenchmark = true;
+        }
+    }
+    resolution = std::min(resolution, maxResolution);
+    
+    // CPU-only benchmarks, no window needed
+    if (benchmark) {
+        runBenchmarks();
+        return 0;
+    }
+    
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);
@@ -707,6 +2767,12 @@ int main(int argc, char** argv) {
     
     init();
     
+    // GPU benchmark, needs the window's context
+    if (drawBenchmark) {
+        benchmarkIndexModes();
+        return 0;
+    }
+    
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
@@ -5,31 +5,90 @@
 #include <vector>
 #include <cstdlib>
 #include <ctime>
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+#include "vertex_compression.h"
+#include "simd_math.h"
+#include "shader_program.h"
+#include "ray_picking.h"
+#include "region_select.h"
 
 // Global variables
-unsigned int shaderProgram;
-unsigned int pickingShaderProgram;
-unsigned int objectVAOs[3], objectVBOs[3], objectEBOs[3];
-unsigned int fbo, colorTexture, depthRenderbuffer;
+ShaderProgram shaderProgram;
+ShaderProgram pickingShaderProgram;
+ShaderProgram fxaaShaderProgram;
+ShaderProgram overlayShaderProgram;
+FrameUniformBuffer frameUniforms;
 
-// Object colors (diffuse)
+// Uniform locations, resolved once after linking
+struct PhongUniforms {
+    int ka, kd, ks, shininess;
+    int positionMin, positionScale;
+    int highlightedObject;
+} phong;
+
+struct PickingUniforms {
+    int positionMin, positionScale;
+} picking;
+
+// One cube mesh shared by every object. Per-object data comes from
+// instanceVBO, so each pass is a single glDrawElementsInstanced call.
+unsigned int cubeVAO, cubeVBO, cubeEBO, instanceVBO;
+MeshBounds cubeBounds;  // Decode transform for the compressed positions
+const int CUBE_INDEX_COUNT = 36;
+// Scene FBO: sceneColorTexture (attachment 0) and idTexture (attachment 1,
+// (object id + 1, triangle id) per pixel as RG32UI, 0 where no object was
+// drawn). Without MSAA display() renders both at once (MRT) and copies
+// the color to the window (through FXAA if enabled), so the id buffer is
+// current after every frame and picks are plain reads. pickingDirty marks
+// camera or scene changes not yet rendered; a pick then runs the id-only
+// pass first. The FBO is always single-sample, so ids stay exact.
+unsigned int fbo, sceneColorTexture, idTexture, depthRenderbuffer;
+unsigned int presentVAO;  // Empty; the FXAA pass draws a full-screen triangle
+int fxaaTexelSize;  // Uniform location
+unsigned int overlayVAO, overlayVBO;  // Selection outline while dragging
+int overlayViewportSize;  // Uniform location
+bool pickingDirty = true;
+int pickingPasses = 0;  // Id-only passes so far
+float nearPlane = 0.1f, farPlane = 100.0f;  // Of the last frame, to linearize picked depth
+int hoveredObject = -1;  // Highlighted under the mouse
+
+// CPU picking (--cpu-picking, C/c): a ray through the pixel against a BVH
+// over the objects' world boxes, then for each candidate the shared cube's
+// triangle BVH in object space. No GPU work or readback.
+BvhMesh cubePickMesh;
+Bvh scenePickBvh;
+bool cpuPicking = false;
+
+// Per-object instance data: attributes 2-5 (model matrix columns), 6, 7
+// and 8 of cubeVAO, one ObjectInstance per object
+struct ObjectInstance {
+    float model[16];
+    float color[3];     // Diffuse
+    uint32_t id;        // Written to the picking buffer (ids must stay below 2^32 - 1)
+    uint32_t selected;  // Nonzero in the region selection (tinted)
+};
+std::vector<ObjectInstance> objects;
+std::vector<uint32_t> selection;  // Ids of the objects with selected set
+int objectCount = 3;  // --objects N
+float sceneRadius = 0.0f;  // Bounding radius of all objects around the origin
+
+// Colors of the default three objects
 float objectColors[3][3] = {
     {1.0f, 0.2f, 0.2f},  // Object 0: Red
     {0.2f, 1.0f, 0.2f},  // Object 1: Green
     {0.2f, 0.2f, 1.0f}   // Object 2: Blue
 };
 
-// Picking colors (unique constant colors for FBO)
-float pickingColors[3][3] = {
-    {1.0f, 0.0f, 0.0f},  // Object 0: Pure Red
-    {0.0f, 1.0f, 0.0f},  // Object 1: Pure Green
-    {0.0f, 0.0f, 1.0f}   // Object 2: Pure Blue
-};
-
-// Camera parameters
+// Camera parameters (the default distance is fitted to the scene)
 float cameraAngleX = 30.0f;
 float cameraAngleY = 45.0f;
 float cameraDistance = 8.0f;
+float defaultCameraDistance = 8.0f;
 float cameraTargetX = 0.0f;
 float cameraTargetY = 0.0f;
 float cameraTargetZ = 0.0f;
@@ -43,40 +102,93 @@ float kd = 0.7f;
 float ks = 0.5f;
 float shininess = 32.0f;
 
-// Anti-aliasing
-bool antiAliasingEnabled = false;
+// Anti-aliasing (A/a cycles the modes). MSAA renders into msaaFBO with
+// msaaSamples samples per pixel and resolves into the window by blit; the
+// ids then come from the single-sample picking pass. FXAA filters the
+// single-sample color on its way to the window.
+enum AntiAliasMode { AA_OFF, AA_MSAA, AA_FXAA };
+AntiAliasMode antiAliasMode = AA_OFF;  // --msaa N, --fxaa
+int msaaSamples = 4;  // 2, 4 or 8 (M/m cycles), at most GL_MAX_SAMPLES
+int maxSamples = 8;
+bool msaaAvailable = true;  // False when GL_MAX_SAMPLES < 2 or msaaFBO is incomplete
+unsigned int msaaFBO, msaaColorRenderbuffer, msaaDepthRenderbuffer;
+
+// Frame-time counters per mode (T/t prints them): CPU time spent in
+// display() and GPU time from GL_TIME_ELAPSED queries, read back
+// FRAME_QUERY_COUNT frames later so they never stall. The first frame
+// pays for lazy driver setup and is not counted.
+const int FRAME_MODE_COUNT = 5;  // Off, FXAA, MSAA 2x, 4x, 8x
+const char* frameModeNames[FRAME_MODE_COUNT] = {"No AA", "FXAA", "MSAA 2x", "MSAA 4x", "MSAA 8x"};
+struct FrameTimes {
+    long frames;
+    double cpuMs;
+    long gpuFrames;
+    double gpuMs;
+};
+FrameTimes frameTimes[FRAME_MODE_COUNT];
+const int FRAME_QUERY_COUNT = 3;
+unsigned int frameQueries[FRAME_QUERY_COUNT];
+int frameQueryMode[FRAME_QUERY_COUNT];  // -1 while unused
+int nextFrameQuery = 0;
+long framesRendered = 0;
+
 int windowWidth = 800;
 int windowHeight = 600;
 
 // Shader source code (Phong shading)
 const char* vertexShaderSource = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec4 aPos;     // unorm16 within the mesh bounds
+layout (location = 1) in vec2 aNormal;  // snorm16 octahedral
+layout (location = 2) in mat4 aModel;   // Per instance (locations 2-5)
+layout (location = 6) in vec3 aColor;   // Per instance
+layout (location = 7) in uint aId;      // Per instance
+layout (location = 8) in uint aSelected; // Per instance
+
+uniform vec3 positionMin;
+uniform vec3 positionScale;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec3 LightDir;
 out vec3 ViewDir;
+out vec3 ObjectColor;
+flat out uint ObjectId;
+
+// Octahedral normal decode (octDecode in vertex_compression.h)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = positionMin + aPos.xyz * positionScale;
+    FragPos = vec3(aModel * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(aModel))) * octDecode(aNormal);
+    ObjectColor = (aSelected != 0u) ? mix(aColor, vec3(1.0, 0.85, 0.2), 0.5) : aColor;
+    ObjectId = aId;
     
-    vec3 worldLightPos = lightPos;
-    vec3 worldViewPos = viewPos;
+    vec3 worldLightPos = lightPos.xyz;
+    vec3 worldViewPos = viewPos.xyz;
     
     LightDir = normalize(worldLightPos - FragPos);
     ViewDir = normalize(worldViewPos - FragPos);
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * aModel * vec4(position, 1.0);
 }
 )";
 
@@ -86,71 +198,179 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec3 LightDir;
 in vec3 ViewDir;
+in vec3 ObjectColor;
+flat in uint ObjectId;
 
 uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float shininess;
-uniform vec3 lightColor;
-uniform vec3 objectColor;
+uniform int highlightedObject;  // -1 for none
 
-out vec4 FragColor;
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out uvec2 PickId;  // Same values as the picking shader
 
 void main()
 {
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(LightDir);
     vec3 viewDir = normalize(ViewDir);
+    vec3 objectColor = (int(ObjectId) == highlightedObject) ? mix(ObjectColor, vec3(1.0), 0.35) : ObjectColor;
     
     // Ambient component
-    vec3 ambient = ka * lightColor * objectColor;
+    vec3 ambient = ka * lightColor.rgb * objectColor;
     
     // Diffuse component
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = kd * diff * lightColor * objectColor;
+    vec3 diffuse = kd * diff * lightColor.rgb * objectColor;
     
     // Specular component
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = ks * spec * lightColor;
+    vec3 specular = ks * spec * lightColor.rgb;
     
     // Combine components
     vec3 result = ambient + diffuse + specular;
     FragColor = vec4(result, 1.0);
+    PickId = uvec2(ObjectId + 1u, uint(gl_PrimitiveID));
 }
 )";
 
-// Picking shader (constant color, no lighting)
+// Picking shader (object and triangle ids, no lighting)
 const char* pickingVertexShaderSource = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos;  // unorm16 within the mesh bounds
+layout (location = 2) in mat4 aModel;  // Per instance (locations 2-5)
+layout (location = 7) in uint aId;     // Per instance
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform vec3 positionMin;
+uniform vec3 positionScale;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
+flat out uint ObjectId;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    ObjectId = aId;
+    gl_Position = projection * view * aModel * vec4(positionMin + aPos.xyz * positionScale, 1.0);
 }
 )";
 
+// Object id + 1 (so the cleared 0 is no object) and the triangle within
+// the mesh, as exact integers
 const char* pickingFragmentShaderSource = R"(
 #version 330 core
-uniform vec3 pickingColor;
+flat in uint ObjectId;
+
+layout (location = 1) out uvec2 PickId;  // idTexture is attachment 1
+
+void main()
+{
+    PickId = uvec2(ObjectId + 1u, uint(gl_PrimitiveID));
+}
+)";
+
+// FXAA shader: sceneColorTexture to the window with edges smoothed along
+// their direction (the FXAA 3 "PC console" variant, one pass, 9 taps)
+const char* fullScreenVertexShaderSource = R"(
+#version 330 core
+void main()
+{
+    // Full-screen triangle from the vertex index
+    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char* fxaaFragmentShaderSource = R"(
+#version 330 core
+uniform sampler2D sceneColor;
+uniform vec2 texelSize;
 
 out vec4 FragColor;
 
+const float REDUCE_MIN = 1.0 / 128.0;
+const float REDUCE_MUL = 1.0 / 8.0;
+const float SPAN_MAX = 8.0;
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.299, 0.587, 0.114));
+}
+
 void main()
 {
-    FragColor = vec4(pickingColor, 1.0);
+    vec2 uv = gl_FragCoord.xy * texelSize;
+    vec3 rgbM = texture(sceneColor, uv).rgb;
+    float lumaNW = luma(texture(sceneColor, uv + vec2(-1.0, -1.0) * texelSize).rgb);
+    float lumaNE = luma(texture(sceneColor, uv + vec2(1.0, -1.0) * texelSize).rgb);
+    float lumaSW = luma(texture(sceneColor, uv + vec2(-1.0, 1.0) * texelSize).rgb);
+    float lumaSE = luma(texture(sceneColor, uv + vec2(1.0, 1.0) * texelSize).rgb);
+    float lumaM = luma(rgbM);
+    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
+    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
+    
+    // Edge direction: perpendicular to the luma gradient
+    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));
+    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * REDUCE_MUL, REDUCE_MIN);
+    float rcpDirMin = 1.0 / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    dir = clamp(dir * rcpDirMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texelSize;
+    
+    // Blend along the edge; the wider blend only if it stays in the local range
+    vec3 rgbA = 0.5 * (texture(sceneColor, uv + dir * (1.0 / 3.0 - 0.5)).rgb +
+                       texture(sceneColor, uv + dir * (2.0 / 3.0 - 0.5)).rgb);
+    vec3 rgbB = rgbA * 0.5 + 0.25 * (texture(sceneColor, uv - dir * 0.5).rgb +
+                                     texture(sceneColor, uv + dir * 0.5).rgb);
+    float lumaB = luma(rgbB);
+    FragColor = vec4((lumaB < lumaMin || lumaB > lumaMax) ? rgbA : rgbB, 1.0);
 }
 )";
 
-// Create a simple mesh (cube-like shape)
-void createMesh(int objectIndex, float size, float offsetX, float offsetY, float offsetZ) {
+// Overlay shader: the selection rectangle or lasso, in window pixels
+const char* overlayVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec2 aPos;  // Origin top-left, as GLUT reports the mouse
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    gl_Position = vec4(aPos.x / viewportSize.x * 2.0 - 1.0, 1.0 - aPos.y / viewportSize.y * 2.0, 0.0, 1.0);
+}
+)";
+
+const char* overlayFragmentShaderSource = R"(
+#version 330 core
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(1.0, 0.85, 0.2, 1.0);
+}
+)";
+
+// Create the shared cube mesh (half-size `size`, centred on the origin) and
+// its VAO, with the per-instance attributes read from instanceVBO
+void createCubeMesh(float size) {
     std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+    std::vector<uint16_t> indices;
     
     // Create a box-like mesh
     float s = size;
@@ -181,16 +401,16 @@ void createMesh(int objectIndex, float size, float offsetX, float offsetY, float
     
     // Add vertices with normals
     for (int i = 0; i < 24; i++) {
-        vertices.push_back(positions[i][0] + offsetX);
-        vertices.push_back(positions[i][1] + offsetY);
-        vertices.push_back(positions[i][2] + offsetZ);
+        vertices.push_back(positions[i][0]);
+        vertices.push_back(positions[i][1]);
+        vertices.push_back(positions[i][2]);
         vertices.push_back(normals[i][0]);
         vertices.push_back(normals[i][1]);
         vertices.push_back(normals[i][2]);
     }
     
-    // Create indices for triangles
-    unsigned int baseIndices[] = {
+    // Create indices for triangles (16-bit, the box has 24 vertices)
+    uint16_t baseIndices[] = {
         0, 1, 2,  2, 3, 0,   // Front
         4, 5, 6,  6, 7, 4,   // Back
         8, 9, 10, 10, 11, 8, // Top
@@ -199,52 +419,189 @@ void createMesh(int objectIndex, float size, float offsetX, float offsetY, float
         20, 21, 22, 22, 23, 20  // Left
     };
     
-    for (int i = 0; i < 36; i++) {
+    for (int i = 0; i < CUBE_INDEX_COUNT; i++) {
         indices.push_back(baseIndices[i]);
     }
+    buildBvhMesh(vertices.data(), vertices.size() / 6, 6, indices.data(), indices.size(), cubePickMesh);
+    
+    // Compressed vertex format (vertex_compression.h)
+    std::vector<uint16_t> packed;
+    cubeBounds = compressMesh("cube", vertices.data(), vertices.size() / 6, 6, packed, true);
+    
+    // Create VAO, VBO, EBO and the instance buffer
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    glGenBuffers(1, &cubeEBO);
+    glGenBuffers(1, &instanceVBO);
     
-    // Create VAO, VBO, EBO
-    glGenVertexArrays(1, &objectVAOs[objectIndex]);
-    glGenBuffers(1, &objectVBOs[objectIndex]);
-    glGenBuffers(1, &objectEBOs[objectIndex]);
+    glBindVertexArray(cubeVAO);
     
-    glBindVertexArray(objectVAOs[objectIndex]);
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(uint16_t), packed.data(), GL_STATIC_DRAW);
     
-    glBindBuffer(GL_ARRAY_BUFFER, objectVBOs[objectIndex]);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, objectEBOs[objectIndex]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    GLsizei stride = compressedVertexShorts(false) * sizeof(uint16_t);
     
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    // Position attribute (unorm16, decoded with cubeBounds)
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)COMPRESSED_POSITION_OFFSET);
     glEnableVertexAttribArray(0);
     
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    // Normal attribute (octahedral snorm16)
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)COMPRESSED_NORMAL_OFFSET);
     glEnableVertexAttribArray(1);
     
+    // Per-instance attributes, advancing once per object
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    GLsizei instanceStride = sizeof(ObjectInstance);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+                              (void*)(offsetof(ObjectInstance, model) + column * 4 * sizeof(float)));
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribDivisor(2 + column, 1);
+    }
+    glVertexAttribPointer(6, 3, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(ObjectInstance, color));
+    glEnableVertexAttribArray(6);
+    glVertexAttribDivisor(6, 1);
+    glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, instanceStride, (void*)offsetof(ObjectInstance, id));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, instanceStride, (void*)offsetof(ObjectInstance, selected));
+    glEnableVertexAttribArray(8);
+    glVertexAttribDivisor(8, 1);
+    
     glBindVertexArray(0);
 }
 
+// Build the BVH over the objects' world boxes for CPU picking
+void buildPickingBvh() {
+    auto start = std::chrono::high_resolution_clock::now();
+    Aabb cubeBox = bvhBounds(cubePickMesh.bvh);
+    std::vector<Aabb> boxes(objects.size());
+    for (size_t i = 0; i < objects.size(); i++) {
+        Mat4 model;
+        memcpy(model.m, objects[i].model, sizeof(model.m));
+        boxes[i] = transformAabb(model, cubeBox);
+    }
+    buildBvh(boxes.data(), boxes.size(), scenePickBvh);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Picking BVH: " << scenePickBvh.nodes.size() << " nodes over " << objects.size() << " objects ("
+              << objects.size() * cubePickMesh.indices.size() / 3 << " triangles), "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
+}
+
+// Fill and upload the instance buffer. The default three cubes keep their
+// places (x = -4, 0, 4) and colors; larger scenes fill a cubic grid with
+// 2 units between centres and fit the camera distance to it.
+void buildScene(int count) {
+    objects.resize(count);
+    selection.clear();
+    int side = (int)std::ceil(std::cbrt((double)count));
+    for (int i = 0; i < count; i++) {
+        ObjectInstance& object = objects[i];
+        object.id = (uint32_t)i;
+        object.selected = 0;
+        if (count == 3) {
+            Mat4 model = Mat4::translation(4.0f * (i - 1), 0.0f, 0.0f);
+            memcpy(object.model, model.m, sizeof(object.model));
+            memcpy(object.color, objectColors[i], sizeof(object.color));
+            continue;
+        }
+        float x = 2.0f * (i % side - (side - 1) * 0.5f);
+        float y = 2.0f * ((i / side) % side - (side - 1) * 0.5f);
+        float z = 2.0f * (i / (side * side) - (side - 1) * 0.5f);
+        Mat4 model = Mat4::translation(x, y, z);
+        memcpy(object.model, model.m, sizeof(object.model));
+        // Scattered but repeatable colors
+        uint32_t hash = (uint32_t)i * 2654435761u;
+        for (int c = 0; c < 3; c++) {
+            object.color[c] = 0.2f + 0.8f * ((hash >> (8 * c + 8)) & 255) / 255.0f;
+        }
+    }
+    
+    float cubeRadius = 0.8f * std::sqrt(3.0f);
+    sceneRadius = (count == 3) ? 4.0f + cubeRadius : std::sqrt(3.0f) * (side - 1) + cubeRadius;
+    defaultCameraDistance = (count == 3) ? 8.0f : std::max(8.0f, sceneRadius / std::sin(22.5f * (float)M_PI / 180.0f));
+    cameraDistance = defaultCameraDistance;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, objects.size() * sizeof(ObjectInstance), objects.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    pickingDirty = true;
+    std::cout << "Scene: " << count << " objects, one instanced draw per pass" << std::endl;
+    buildPickingBvh();
+}
+
+// Re-upload one object's color after it changed
+void updateObjectColor(int id) {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, id * sizeof(ObjectInstance) + offsetof(ObjectInstance, color),
+                    sizeof(objects[id].color), objects[id].color);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Largest of 2, 4 and 8 samples that is at most `samples` and
+// GL_MAX_SAMPLES (which need not be a power of two), so each count keeps
+// its own frame-time slot
+int supportedMsaaSamples(int samples) {
+    int limit = std::min(samples, maxSamples);
+    return limit >= 8 ? 8 : limit >= 4 ? 4 : 2;
+}
+
+// (Re)allocate the MSAA buffers for the window size and msaaSamples. If
+// the result is incomplete MSAA is turned off for the rest of the run.
+void resizeMsaaBuffers() {
+    if (!msaaAvailable) {
+        return;
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaColorRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaaSamples, GL_RGBA8, windowWidth, windowHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaDepthRenderbuffer);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, msaaSamples, GL_DEPTH_COMPONENT24, windowWidth, windowHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, msaaFBO);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "MSAA framebuffer not complete at " << msaaSamples << " samples, MSAA disabled" << std::endl;
+        msaaAvailable = false;
+        if (antiAliasMode == AA_MSAA) {
+            antiAliasMode = AA_OFF;
+        }
+    }
+}
+
 // Create FBO for picking
 void createFBO() {
     // Create FBO
     glGenFramebuffers(1, &fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
     
-    // Create texture for color attachment
-    glGenTextures(1, &colorTexture);
-    glBindTexture(GL_TEXTURE_2D, colorTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, windowWidth, windowHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    // Create texture for the scene color attachment
+    glGenTextures(1, &sceneColorTexture);
+    glBindTexture(GL_TEXTURE_2D, sceneColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, windowWidth, windowHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);  // FXAA samples between texels
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
-    
-    // Create renderbuffer for depth
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColorTexture, 0);
+    
+    // Create integer texture for the id attachment (integer formats are
+    // never filtered)
+    glGenTextures(1, &idTexture);
+    glBindTexture(GL_TEXTURE_2D, idTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, windowWidth, windowHeight, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, idTexture, 0);
+    
+    // Create renderbuffer for depth (read back by pickPixel)
     glGenRenderbuffers(1, &depthRenderbuffer);
     glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, windowWidth, windowHeight);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, windowWidth, windowHeight);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
     
     // Check FBO completeness
@@ -253,163 +610,599 @@ void createFBO() {
     }
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    // Multisampled color and depth for MSAA frames, if the GL can
+    // multisample at all
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    if (maxSamples < 2) {
+        if (antiAliasMode == AA_MSAA) {
+            std::cerr << "--msaa: multisampling is not supported (GL_MAX_SAMPLES = " << maxSamples << ")" << std::endl;
+            exit(1);
+        }
+        std::cout << "MSAA disabled: GL_MAX_SAMPLES = " << maxSamples << std::endl;
+        msaaAvailable = false;
+        return;
+    }
+    msaaSamples = supportedMsaaSamples(msaaSamples);
+    glGenFramebuffers(1, &msaaFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, msaaFBO);
+    glGenRenderbuffers(1, &msaaColorRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaColorRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, msaaColorRenderbuffer);
+    glGenRenderbuffers(1, &msaaDepthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, msaaDepthRenderbuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, msaaDepthRenderbuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    resizeMsaaBuffers();  // Allocates the storage and checks completeness
 }
 
 // Resize FBO
 void resizeFBO(int width, int height) {
     windowWidth = width;
     windowHeight = height;
+    pickingDirty = true;
     
-    // Resize texture
-    glBindTexture(GL_TEXTURE_2D, colorTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    // Resize textures
+    glBindTexture(GL_TEXTURE_2D, sceneColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, idTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32UI, width, height, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
     
-    // Resize renderbuffer
+    // Resize renderbuffers
     glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    resizeMsaaBuffers();
 }
 
-// Matrix functions
-void createIdentityMatrix(float* matrix) {
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
-    }
-}
-
-void createLookAtMatrix(float* matrix, float eyeX, float eyeY, float eyeZ,
-                       float centerX, float centerY, float centerZ,
-                       float upX, float upY, float upZ) {
-    float f[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
-    float len = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
-    if (len > 1e-6f) {
-        f[0] /= len; f[1] /= len; f[2] /= len;
-    }
-    
-    float s[3] = {
-        f[1] * upZ - f[2] * upY,
-        f[2] * upX - f[0] * upZ,
-        f[0] * upY - f[1] * upX
-    };
-    len = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
-    if (len > 1e-6f) {
-        s[0] /= len; s[1] /= len; s[2] /= len;
-    }
-    
-    float u[3] = {
-        s[1] * f[2] - s[2] * f[1],
-        s[2] * f[0] - s[0] * f[2],
-        s[0] * f[1] - s[1] * f[0]
-    };
-    
-    createIdentityMatrix(matrix);
-    matrix[0] = s[0]; matrix[4] = s[1]; matrix[8] = s[2];
-    matrix[1] = u[0]; matrix[5] = u[1]; matrix[9] = u[2];
-    matrix[2] = -f[0]; matrix[6] = -f[1]; matrix[10] = -f[2];
-    matrix[12] = -(s[0]*eyeX + s[1]*eyeY + s[2]*eyeZ);
-    matrix[13] = -(u[0]*eyeX + u[1]*eyeY + u[2]*eyeZ);
-    matrix[14] = f[0]*eyeX + f[1]*eyeY + f[2]*eyeZ;
+// Camera of the current view (also used for CPU picking rays)
+void cameraMatrices(Mat4& view, Mat4& projection, Vec3& eye) {
+    eye.x = cameraTargetX + cameraDistance * cos(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
+    eye.y = cameraTargetY + cameraDistance * sin(cameraAngleX * M_PI / 180.0f);
+    eye.z = cameraTargetZ + cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
+    
+    view = Mat4::lookAt(eye, Vec3{cameraTargetX, cameraTargetY, cameraTargetZ}, Vec3{0.0f, 1.0f, 0.0f});
+    projection = Mat4::perspective(45.0f, (float)windowWidth / windowHeight, nearPlane, farPlane);
 }
 
-void createPerspectiveMatrix(float* matrix, float fovy, float aspect, float near, float far) {
-    float f = 1.0f / tan(fovy * M_PI / 360.0f);
-    
-    createIdentityMatrix(matrix);
-    matrix[0] = f / aspect;
-    matrix[5] = f;
-    matrix[10] = (far + near) / (near - far);
-    matrix[11] = -1.0f;
-    matrix[14] = (2.0f * far * near) / (near - far);
-    matrix[15] = 0.0f;
+// Upload camera and light for the current view to the frame uniform block
+void updateFrameUniforms() {
+    farPlane = std::max(100.0f, cameraDistance + 2.0f * sceneRadius);
+    Mat4 view, projection;
+    Vec3 eye;
+    cameraMatrices(view, projection, eye);
+    
+    FrameUniforms frame;
+    float viewPos[3] = {eye.x, eye.y, eye.z};
+    float lightColor[3] = {1.0f, 1.0f, 1.0f};
+    setFrameUniforms(frame, view.m, projection.m, lightPos, viewPos, lightColor);
+    frameUniforms.update(frame);
 }
 
-// Render scene to FBO for picking
+// Render the id attachment only, for picks while the view has changed
+// since the last MRT frame (or MSAA frames leave the ids alone)
 void renderPickingScene() {
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    const GLenum idOnly[2] = {GL_NONE, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, idOnly);
     glViewport(0, 0, windowWidth, windowHeight);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    
-    // Calculate camera position
-    float camX = cameraTargetX + cameraDistance * cos(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
-    float camY = cameraTargetY + cameraDistance * sin(cameraAngleX * M_PI / 180.0f);
-    float camZ = cameraTargetZ + cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
+    const GLuint noObject[4] = {0, 0, 0, 0};
+    glClearBufferuiv(GL_COLOR, 1, noObject);
+    glClear(GL_DEPTH_BUFFER_BIT);
     
-    float model[16], view[16], projection[16];
-    createIdentityMatrix(model);
-    createLookAtMatrix(view, camX, camY, camZ, cameraTargetX, cameraTargetY, cameraTargetZ, 0.0f, 1.0f, 0.0f);
-    createPerspectiveMatrix(projection, 45.0f, (float)windowWidth / windowHeight, 0.1f, 100.0f);
+    updateFrameUniforms();
     
-    glUseProgram(pickingShaderProgram);
+    pickingShaderProgram.use();
+    pickingShaderProgram.setVec3(picking.positionMin, cubeBounds.min[0], cubeBounds.min[1], cubeBounds.min[2]);
+    pickingShaderProgram.setVec3(picking.positionScale, cubeBounds.scale[0], cubeBounds.scale[1], cubeBounds.scale[2]);
     
-    glUniformMatrix4fv(glGetUniformLocation(pickingShaderProgram, "model"), 1, GL_FALSE, model);
-    glUniformMatrix4fv(glGetUniformLocation(pickingShaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(pickingShaderProgram, "projection"), 1, GL_FALSE, projection);
-    
-    // Draw objects with picking colors
-    float offsets[3][3] = {
-        {-2.0f, 0.0f, 0.0f},  // Object 0
-        { 0.0f, 0.0f, 0.0f},  // Object 1
-        { 2.0f, 0.0f, 0.0f}   // Object 2
-    };
-    
-    for (int i = 0; i < 3; i++) {
-        // Create model matrix with translation
-        createIdentityMatrix(model);
-        model[12] = offsets[i][0];
-        model[13] = offsets[i][1];
-        model[14] = offsets[i][2];
-        
-        glUniformMatrix4fv(glGetUniformLocation(pickingShaderProgram, "model"), 1, GL_FALSE, model);
-        glUniform3f(glGetUniformLocation(pickingShaderProgram, "pickingColor"), 
-                   pickingColors[i][0], pickingColors[i][1], pickingColors[i][2]);
-        
-        glBindVertexArray(objectVAOs[i]);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
+    // Every object in one draw, each writing its id
+    glBindVertexArray(cubeVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, 0, (GLsizei)objects.size());
+    glBindVertexArray(0);
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    pickingDirty = false;
+    pickingPasses++;
 }
 
-// Get object ID from pixel color
-int getObjectIdFromPixel(int x, int y) {
-    renderPickingScene();
+// What a pixel of the picking buffer shows: objectId and triangleId are
+// -1 over the background; depth is the eye-space distance along the view
+// axis (only filled when asked for)
+struct PickResult {
+    long objectId;
+    long triangleId;
+    float depth;
+};
+
+// Read a width x height block of the id buffer (and depth) with window
+// pixel (x, y) as its top-left corner, rendering the id buffer first only
+// if it is out of date. Rows come back bottom up. ids and depth are client
+// pointers, or offsets into the bound GL_PIXEL_PACK_BUFFER.
+void readPickRegion(int x, int y, int width, int height, bool readDepth, void* ids, void* depth) {
+    if (pickingDirty) {
+        renderPickingScene();
+    }
     
-    // Read pixel from FBO
-    unsigned char pixel[3];
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
-    glReadBuffer(GL_COLOR_ATTACHMENT0);
-    glReadPixels(x, windowHeight - y - 1, 1, 1, GL_RGB, GL_UNSIGNED_BYTE, pixel);
+    glReadBuffer(GL_COLOR_ATTACHMENT1);
+    glReadPixels(x, windowHeight - y - height, width, height, GL_RG_INTEGER, GL_UNSIGNED_INT, ids);
+    if (readDepth) {
+        glReadPixels(x, windowHeight - y - height, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depth);
+    }
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void readPickPixel(int x, int y, bool readDepth, void* ids, void* depth) {
+    readPickRegion(x, y, 1, 1, readDepth, ids, depth);
+}
+
+// Pick result from a read id pair and window depth, with the clip planes
+// the id buffer was rendered with
+PickResult decodePick(const GLuint ids[2], float depth, float zNear, float zFar) {
+    PickResult result;
+    result.objectId = (ids[0] > 0 && ids[0] <= objects.size()) ? (long)ids[0] - 1 : -1;
+    result.triangleId = result.objectId >= 0 ? (long)ids[1] : -1;
+    // Window depth back to eye space (inverse of the perspective depth mapping)
+    float ndc = 2.0f * depth - 1.0f;
+    result.depth = 2.0f * zNear * zFar / (zFar + zNear - ndc * (zFar - zNear));
+    return result;
+}
+
+// Pick window pixel (x, y) exactly, waiting for the GPU
+PickResult pickPixel(int x, int y, bool readDepth = false) {
+    GLuint ids[2] = {0, 0};
+    float depth = 1.0f;
+    readPickPixel(x, y, readDepth, ids, &depth);
+    return decodePick(ids, depth, nearPlane, farPlane);
+}
+
+// Nearest surface under window pixel (x, y), found on the CPU
+struct RayHit {
+    long objectId;    // -1 for background
+    long triangleId;  // Same numbering as gl_PrimitiveID
+    Vec3 point;       // World space
+    float distance;   // From the eye
+    float depth;      // Eye-space depth, as PickResult::depth
+};
+
+RayHit rayPick(int x, int y) {
+    Mat4 view, projection;
+    Vec3 eye;
+    cameraMatrices(view, projection, eye);
+    Ray ray = screenRay(view, projection, eye, x, y, windowWidth, windowHeight);
+    
+    RayHit hit;
+    hit.objectId = -1;
+    hit.triangleId = -1;
+    float tMax = farPlane * 2.0f;
+    traverseBvh(scenePickBvh, ray, tMax, [&](uint32_t object, float& limit) {
+        // The inverse model keeps t, so one limit serves every object
+        Mat4 model;
+        memcpy(model.m, objects[object].model, sizeof(model.m));
+        uint32_t triangle;
+        if (intersectBvhMesh(cubePickMesh, transformRay(inverse(model), ray), limit, triangle)) {
+            hit.objectId = object;
+            hit.triangleId = triangle;
+        }
+    });
+    
+    hit.distance = tMax;
+    hit.point = ray.origin + ray.direction * tMax;
+    // View-space z of the direction (third row of the view matrix)
+    hit.depth = -tMax * (view.m[2] * ray.direction.x + view.m[6] * ray.direction.y + view.m[10] * ray.direction.z);
+    return hit;
+}
+
+// Asynchronous picks. A request copies its pixel into one of
+// PICK_BUFFER_COUNT pixel pack buffers and fences the copy; pollPicks()
+// maps a buffer only once its fence has signaled, a frame or two later,
+// and passes the result to the request's callback in request order.
+// Nothing waits on the GPU unless more than PICK_BUFFER_COUNT picks are
+// in flight. --sync-picks resolves each request at once (pickPixel).
+typedef void (*PickCallback)(int x, int y, const PickResult& result);
+
+const int PICK_BUFFER_COUNT = 2;
+const int PICK_POLL_MS = 16;  // About one frame
+
+struct PendingPick {
+    GLsync fence;  // Null when the slot is free
+    unsigned int sequence;
+    int x, y;
+    bool readDepth;
+    float nearPlane, farPlane;
+    PickCallback callback;
+};
+
+unsigned int pickBuffers[PICK_BUFFER_COUNT];  // (id + 1, triangle, depth) each
+PendingPick pendingPicks[PICK_BUFFER_COUNT];
+int nextPickSlot = 0;
+unsigned int pickSequence = 0;
+bool pickTimerArmed = false;
+bool syncPicks = false;  // --sync-picks
+
+void createPickBuffers() {
+    glGenBuffers(PICK_BUFFER_COUNT, pickBuffers);
+    for (int i = 0; i < PICK_BUFFER_COUNT; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pickBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, 3 * sizeof(GLuint), nullptr, GL_STREAM_READ);
+        pendingPicks[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+bool picksPending() {
+    for (int i = 0; i < PICK_BUFFER_COUNT; i++) {
+        if (pendingPicks[i].fence) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Deliver the pick in slot if its copy has finished (or wait for it);
+// false if it is still in flight
+bool resolvePick(int slot, bool wait) {
+    PendingPick& pick = pendingPicks[slot];
+    GLenum status = glClientWaitSync(pick.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                     wait ? 1000000000ull : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(pick.fence);
+    pick.fence = 0;
+    
+    GLuint ids[2] = {0, 0};
+    float depth = 1.0f;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pickBuffers[slot]);
+    const GLuint* data = (const GLuint*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 3 * sizeof(GLuint), GL_MAP_READ_BIT);
+    if (data) {
+        ids[0] = data[0];
+        ids[1] = data[1];
+        if (pick.readDepth) {
+            memcpy(&depth, data + 2, sizeof(float));
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
     
-    // Convert pixel color to object ID
-    float r = pixel[0] / 255.0f;
-    float g = pixel[1] / 255.0f;
-    float b = pixel[2] / 255.0f;
-    
-    // Check which picking color matches (with tolerance)
-    for (int i = 0; i < 3; i++) {
-        if (fabs(r - pickingColors[i][0]) < 0.1f &&
-            fabs(g - pickingColors[i][1]) < 0.1f &&
-            fabs(b - pickingColors[i][2]) < 0.1f) {
-            return i;
+    pick.callback(pick.x, pick.y, decodePick(ids, depth, pick.nearPlane, pick.farPlane));
+    return true;
+}
+
+// Deliver finished picks, oldest first; with wait, deliver all of them
+void pollPicks(bool wait) {
+    for (int n = 0; n < PICK_BUFFER_COUNT; n++) {
+        int oldest = -1;
+        for (int i = 0; i < PICK_BUFFER_COUNT; i++) {
+            if (pendingPicks[i].fence && (oldest < 0 || pendingPicks[i].sequence < pendingPicks[oldest].sequence)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0 || !resolvePick(oldest, wait)) {
+            return;
+        }
+    }
+}
+
+void updateHover();
+
+void pollPicksTimer(int) {
+    pickTimerArmed = false;
+    pollPicks(false);
+    updateHover();
+    if (picksPending()) {
+        pickTimerArmed = true;
+        glutTimerFunc(PICK_POLL_MS, pollPicksTimer, 0);
+    }
+}
+
+// Pick window pixel (x, y); callback gets the result once the GPU has it.
+// Callbacks must not request picks themselves.
+void requestPick(int x, int y, bool readDepth, PickCallback callback) {
+    if (syncPicks) {
+        callback(x, y, pickPixel(x, y, readDepth));
+        return;
+    }
+    
+    // The slot's previous request is the oldest in flight; only it can stall
+    int slot = nextPickSlot;
+    if (pendingPicks[slot].fence) {
+        resolvePick(slot, true);
+    }
+    nextPickSlot = (slot + 1) % PICK_BUFFER_COUNT;
+    
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pickBuffers[slot]);
+    readPickPixel(x, y, readDepth, (void*)0, (void*)(2 * sizeof(GLuint)));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    PendingPick& pick = pendingPicks[slot];
+    pick.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pick.sequence = pickSequence++;
+    pick.x = x;
+    pick.y = y;
+    pick.readDepth = readDepth;
+    pick.nearPlane = nearPlane;
+    pick.farPlane = farPlane;
+    pick.callback = callback;
+    glFlush();  // Submit the copy and fence now, not at the next swap
+    
+    if (!pickTimerArmed) {
+        pickTimerArmed = true;
+        glutTimerFunc(PICK_POLL_MS, pollPicksTimer, 0);
+    }
+}
+
+void clickPicked(int, int, const PickResult& pick) {
+    int objectId = (int)pick.objectId;
+    if (objectId >= 0) {
+        // Change object color to random value
+        float* color = objects[objectId].color;
+        color[0] = (float)rand() / RAND_MAX;
+        color[1] = (float)rand() / RAND_MAX;
+        color[2] = (float)rand() / RAND_MAX;
+        updateObjectColor(objectId);  // Ids are unchanged, the id buffer stays valid
+        std::cout << "Object " << objectId << " clicked! New color: ("
+                 << color[0] << ", "
+                 << color[1] << ", "
+                 << color[2] << "), triangle " << pick.triangleId << ", depth " << pick.depth << std::endl;
+        glutPostRedisplay();
+    }
+}
+
+void pickClick(int x, int y) {
+    if (cpuPicking) {
+        auto start = std::chrono::high_resolution_clock::now();
+        RayHit hit = rayPick(x, y);
+        auto end = std::chrono::high_resolution_clock::now();
+        if (hit.objectId >= 0) {
+            std::cout << "Ray hit (" << hit.point.x << ", " << hit.point.y << ", " << hit.point.z
+                      << "), distance " << hit.distance << ", "
+                      << std::chrono::duration<double, std::micro>(end - start).count() << " us" << std::endl;
+        }
+        PickResult pick = {hit.objectId, hit.triangleId, hit.depth};
+        clickPicked(x, y, pick);
+    } else {
+        requestPick(x, y, true, clickPicked);
+    }
+}
+
+// Region selection: a left drag selects the objects in a rectangle, or in a
+// lasso with Shift held, from one read of the id buffer block under it
+// (region_select.h). A release within DRAG_THRESHOLD pixels of the press is
+// a click instead.
+const int DRAG_THRESHOLD = 4;
+bool dragging = false;
+bool lassoDrag = false;
+int dragStartX = 0, dragStartY = 0, dragEndX = 0, dragEndY = 0;
+int dragExtent = 0;  // Farthest the mouse got from the press, in pixels
+std::vector<float> lassoPoints;  // Window x, y pairs
+bool fullyVisibleOnly = false;  // --fully-visible, V/v
+int selectionThreads = std::max(1u, std::thread::hardware_concurrency());
+
+// Replace the selection, re-uploading the span of objects whose flag changed
+void setSelection(const std::vector<uint32_t>& ids) {
+    size_t first = objects.size(), last = 0;
+    for (size_t i = 0; i < selection.size(); i++) {
+        objects[selection[i]].selected = 0;
+        first = std::min(first, (size_t)selection[i]);
+        last = std::max(last, (size_t)selection[i]);
+    }
+    for (size_t i = 0; i < ids.size(); i++) {
+        objects[ids[i]].selected = 1;
+        first = std::min(first, (size_t)ids[i]);
+        last = std::max(last, (size_t)ids[i]);
+    }
+    selection = ids;
+    if (first <= last) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(ObjectInstance), (last - first + 1) * sizeof(ObjectInstance),
+                        &objects[first]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void selectDragRegion() {
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    // Pixel bounds of the region, clamped to the window
+    float minX = (float)std::min(dragStartX, dragEndX), maxX = (float)std::max(dragStartX, dragEndX);
+    float minY = (float)std::min(dragStartY, dragEndY), maxY = (float)std::max(dragStartY, dragEndY);
+    if (lassoDrag) {
+        minX = maxX = lassoPoints[0];
+        minY = maxY = lassoPoints[1];
+        for (size_t i = 0; i < lassoPoints.size(); i += 2) {
+            minX = std::min(minX, lassoPoints[i]);
+            maxX = std::max(maxX, lassoPoints[i]);
+            minY = std::min(minY, lassoPoints[i + 1]);
+            maxY = std::max(maxY, lassoPoints[i + 1]);
+        }
+    }
+    int x0 = std::max(0, (int)minX), x1 = std::min(windowWidth - 1, (int)maxX);
+    int y0 = std::max(0, (int)minY), y1 = std::min(windowHeight - 1, (int)maxY);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+    int width = x1 - x0 + 1;
+    int height = y1 - y0 + 1;
+    
+    std::vector<uint32_t> ids((size_t)width * height * 2);
+    std::vector<float> depths(fullyVisibleOnly ? (size_t)width * height : 0);
+    readPickRegion(x0, y0, width, height, fullyVisibleOnly, ids.data(), depths.data());
+    
+    // Lasso points to mask pixels: rows bottom up, mouse positions at pixel centres
+    std::vector<uint8_t> mask;
+    if (lassoDrag) {
+        std::vector<float> points(lassoPoints.size());
+        for (size_t i = 0; i < lassoPoints.size(); i += 2) {
+            points[i] = lassoPoints[i] + 0.5f - x0;
+            points[i + 1] = y1 + 0.5f - lassoPoints[i + 1];
         }
+        rasterizeLasso(points, width, height, mask);
     }
     
-    return -1; // No object found
+    std::vector<uint32_t> found;
+    selectRegion(ids.data(), depths.data(), lassoDrag ? mask.data() : nullptr, width, height, objects.size(),
+                 fullyVisibleOnly, selectionThreads, found);
+    setSelection(found);
+    
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Selected " << found.size() << " objects in a " << width << " x " << height
+              << (lassoDrag ? " lasso" : " rectangle") << (fullyVisibleOnly ? " (fully visible only)" : "") << ", "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
 }
 
 void mouse(int button, int state, int x, int y) {
-    if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN) {
-        int objectId = getObjectIdFromPixel(x, y);
-        if (objectId >= 0 && objectId < 3) {
-            // Change object color to random value
-            objectColors[objectId][0] = (float)rand() / RAND_MAX;
-            objectColors[objectId][1] = (float)rand() / RAND_MAX;
-            objectColors[objectId][2] = (float)rand() / RAND_MAX;
-            std::cout << "Object " << objectId << " clicked! New color: ("
-                     << objectColors[objectId][0] << ", "
-                     << objectColors[objectId][1] << ", "
-                     << objectColors[objectId][2] << ")" << std::endl;
-            glutPostRedisplay();
+    if (button != GLUT_LEFT_BUTTON) {
+        return;
+    }
+    if (state == GLUT_DOWN) {
+        dragging = true;
+        lassoDrag = (glutGetModifiers() & GLUT_ACTIVE_SHIFT) != 0;
+        dragStartX = dragEndX = x;
+        dragStartY = dragEndY = y;
+        dragExtent = 0;
+        lassoPoints.clear();
+        lassoPoints.push_back((float)x);
+        lassoPoints.push_back((float)y);
+        return;
+    }
+    if (!dragging) {
+        return;
+    }
+    dragging = false;
+    if (dragExtent < DRAG_THRESHOLD) {
+        pickClick(dragStartX, dragStartY);
+    } else {
+        selectDragRegion();
+    }
+    glutPostRedisplay();
+}
+
+void motion(int x, int y) {
+    if (!dragging) {
+        return;
+    }
+    dragEndX = x;
+    dragEndY = y;
+    dragExtent = std::max(dragExtent, std::max(std::abs(x - dragStartX), std::abs(y - dragStartY)));
+    size_t last = lassoPoints.size() - 2;
+    if (std::abs(x - lassoPoints[last]) + std::abs(y - lassoPoints[last + 1]) >= 2.0f) {
+        lassoPoints.push_back((float)x);
+        lassoPoints.push_back((float)y);
+    }
+    glutPostRedisplay();
+}
+
+// Outline of the region being dragged, drawn over the finished frame
+void drawSelectionOverlay() {
+    std::vector<float> outline;
+    if (lassoDrag) {
+        outline = lassoPoints;
+    } else {
+        float x0 = dragStartX + 0.5f, y0 = dragStartY + 0.5f, x1 = dragEndX + 0.5f, y1 = dragEndY + 0.5f;
+        float corners[8] = {x0, y0, x1, y0, x1, y1, x0, y1};
+        outline.assign(corners, corners + 8);
+    }
+    
+    glDisable(GL_DEPTH_TEST);
+    overlayShaderProgram.use();
+    overlayShaderProgram.setVec2(overlayViewportSize, (float)windowWidth, (float)windowHeight);
+    glBindVertexArray(overlayVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glBufferData(GL_ARRAY_BUFFER, outline.size() * sizeof(float), outline.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_LINE_LOOP, 0, (GLsizei)(outline.size() / 2));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+// Hover highlighting: at most one hover pick in flight; moves meanwhile
+// only update the position, which is picked when the previous one lands
+int hoverX = 0, hoverY = 0;
+bool hoverMoved = false;
+bool hoverInFlight = false;
+
+void hoverPicked(int, int, const PickResult& pick) {
+    hoverInFlight = false;
+    if ((int)pick.objectId != hoveredObject) {
+        hoveredObject = (int)pick.objectId;
+        glutPostRedisplay();
+    }
+}
+
+void updateHover() {
+    if (hoverMoved && !hoverInFlight) {
+        hoverMoved = false;
+        hoverInFlight = true;
+        requestPick(hoverX, hoverY, false, hoverPicked);
+    }
+}
+
+void passiveMotion(int x, int y) {
+    if (cpuPicking) {
+        PickResult pick = {rayPick(x, y).objectId, -1, 0.0f};
+        hoverPicked(x, y, pick);
+        return;
+    }
+    hoverX = x;
+    hoverY = y;
+    hoverMoved = true;
+    updateHover();
+}
+
+// Frame-time slot of the current anti-aliasing mode
+int frameMode() {
+    if (antiAliasMode == AA_MSAA) {
+        return msaaSamples >= 8 ? 4 : msaaSamples >= 4 ? 3 : 2;
+    }
+    return antiAliasMode == AA_FXAA ? 1 : 0;
+}
+
+// Start the GPU timer of this frame, first collecting the result of the
+// frame that used the query FRAME_QUERY_COUNT frames ago (if it is ready)
+void beginFrameTimer() {
+    if (framesRendered == 0) {
+        return;
+    }
+    int slot = nextFrameQuery;
+    if (frameQueryMode[slot] >= 0) {
+        GLint available = 0;
+        glGetQueryObjectiv(frameQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(frameQueries[slot], GL_QUERY_RESULT, &nanoseconds);
+            frameTimes[frameQueryMode[slot]].gpuFrames++;
+            frameTimes[frameQueryMode[slot]].gpuMs += nanoseconds * 1e-6;
+        }
+    }
+    frameQueryMode[slot] = frameMode();
+    glBeginQuery(GL_TIME_ELAPSED, frameQueries[slot]);
+}
+
+void endFrameTimer(std::chrono::high_resolution_clock::time_point start) {
+    if (framesRendered++ == 0) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    nextFrameQuery = (nextFrameQuery + 1) % FRAME_QUERY_COUNT;
+    FrameTimes& times = frameTimes[frameMode()];
+    times.frames++;
+    times.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void printFrameTimes() {
+    std::cout << "Frame times (average per frame):" << std::endl;
+    for (int mode = 0; mode < FRAME_MODE_COUNT; mode++) {
+        const FrameTimes& times = frameTimes[mode];
+        if (times.frames == 0) {
+            continue;
+        }
+        std::cout << "  " << frameModeNames[mode] << ": " << times.frames << " frames, CPU "
+                  << times.cpuMs / times.frames << " ms, GPU ";
+        if (times.gpuFrames > 0) {
+            std::cout << times.gpuMs / times.gpuFrames << " ms" << std::endl;
+        } else {
+            std::cout << "pending" << std::endl;
         }
     }
 }
@@ -418,20 +1211,44 @@ void keyboard(unsigned char key, int x, int y) {
     switch(key) {
         case 'a':
         case 'A':
-            antiAliasingEnabled = !antiAliasingEnabled;
-            if (antiAliasingEnabled) {
-                glEnable(GL_MULTISAMPLE);
-                std::cout << "Anti-aliasing enabled" << std::endl;
+            if (antiAliasMode == AA_OFF) {
+                antiAliasMode = msaaAvailable ? AA_MSAA : AA_FXAA;
             } else {
-                glDisable(GL_MULTISAMPLE);
-                std::cout << "Anti-aliasing disabled" << std::endl;
+                antiAliasMode = (antiAliasMode == AA_MSAA) ? AA_FXAA : AA_OFF;
             }
+            std::cout << "Anti-aliasing: " << frameModeNames[frameMode()] << std::endl;
+            break;
+        case 'm':
+        case 'M':
+            if (!msaaAvailable) {
+                std::cout << "MSAA is not available" << std::endl;
+                break;
+            }
+            msaaSamples = (supportedMsaaSamples(msaaSamples * 2) == msaaSamples) ? 2 : msaaSamples * 2;
+            resizeMsaaBuffers();
+            std::cout << "MSAA samples: " << msaaSamples << std::endl;
+            break;
+        case 't':
+        case 'T':
+            printFrameTimes();
+            break;
+        case 'v':
+        case 'V':
+            fullyVisibleOnly = !fullyVisibleOnly;
+            std::cout << "Region selection: " << (fullyVisibleOnly ? "fully visible objects only" : "any visible pixel")
+                      << std::endl;
+            break;
+        case 'c':
+        case 'C':
+            cpuPicking = !cpuPicking;
+            std::cout << "Picking: " << (cpuPicking ? "CPU ray cast (BVH)" : "GPU id buffer") << std::endl;
             break;
         case 'r':
         case 'R':
             cameraAngleX = 30.0f;
             cameraAngleY = 45.0f;
-            cameraDistance = 8.0f;
+            cameraDistance = defaultCameraDistance;
+            pickingDirty = true;
             break;
         case 27: // ESC
             exit(0);
@@ -455,59 +1272,90 @@ void specialKeys(int key, int x, int y) {
         case GLUT_KEY_RIGHT:
             cameraAngleY += delta;
             break;
+        case GLUT_KEY_PAGE_UP:
+            cameraDistance = std::max(2.0f, cameraDistance * 0.8f);
+            break;
+        case GLUT_KEY_PAGE_DOWN:
+            cameraDistance = std::min(4.0f * defaultCameraDistance, cameraDistance * 1.25f);
+            break;
     }
+    pickingDirty = true;
     glutPostRedisplay();
 }
 
 void display() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    auto start = std::chrono::high_resolution_clock::now();
+    beginFrameTimer();
+    
+    // MSAA renders color only into msaaFBO; otherwise color and ids go
+    // together into the picking FBO
+    bool msaa = (antiAliasMode == AA_MSAA);
+    const float background[4] = {0.1f, 0.1f, 0.1f, 1.0f};
+    if (msaa) {
+        glBindFramebuffer(GL_FRAMEBUFFER, msaaFBO);
+        glClearBufferfv(GL_COLOR, 0, background);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        const GLenum both[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, both);
+        const GLuint noObject[4] = {0, 0, 0, 0};
+        glClearBufferfv(GL_COLOR, 0, background);
+        glClearBufferuiv(GL_COLOR, 1, noObject);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
     glViewport(0, 0, windowWidth, windowHeight);
     
-    // Calculate camera position
-    float camX = cameraTargetX + cameraDistance * cos(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
-    float camY = cameraTargetY + cameraDistance * sin(cameraAngleX * M_PI / 180.0f);
-    float camZ = cameraTargetZ + cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
-    
-    float model[16], view[16], projection[16];
-    createIdentityMatrix(model);
-    createLookAtMatrix(view, camX, camY, camZ, cameraTargetX, cameraTargetY, cameraTargetZ, 0.0f, 1.0f, 0.0f);
-    createPerspectiveMatrix(projection, 45.0f, (float)windowWidth / windowHeight, 0.1f, 100.0f);
-    
-    glUseProgram(shaderProgram);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), lightPos[0], lightPos[1], lightPos[2]);
-    glUniform3f(glGetUniformLocation(shaderProgram, "viewPos"), camX, camY, camZ);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderProgram, "shininess"), shininess);
-    
-    // Draw objects
-    float offsets[3][3] = {
-        {-2.0f, 0.0f, 0.0f},  // Object 0
-        { 0.0f, 0.0f, 0.0f},  // Object 1
-        { 2.0f, 0.0f, 0.0f}   // Object 2
-    };
+    updateFrameUniforms();
     
-    for (int i = 0; i < 3; i++) {
-        createIdentityMatrix(model);
-        model[12] = offsets[i][0];
-        model[13] = offsets[i][1];
-        model[14] = offsets[i][2];
-        
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-        glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 
-                   objectColors[i][0], objectColors[i][1], objectColors[i][2]);
-        
-        glBindVertexArray(objectVAOs[i]);
-        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-    }
+    shaderProgram.use();
+    
+    shaderProgram.setFloat(phong.ka, ka);
+    shaderProgram.setFloat(phong.kd, kd);
+    shaderProgram.setFloat(phong.ks, ks);
+    shaderProgram.setFloat(phong.shininess, shininess);
+    shaderProgram.setVec3(phong.positionMin, cubeBounds.min[0], cubeBounds.min[1], cubeBounds.min[2]);
+    shaderProgram.setVec3(phong.positionScale, cubeBounds.scale[0], cubeBounds.scale[1], cubeBounds.scale[2]);
+    shaderProgram.setInt(phong.highlightedObject, hoveredObject);
     
+    // Every object in one draw; transform and color come from instanceVBO
+    glBindVertexArray(cubeVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, CUBE_INDEX_COUNT, GL_UNSIGNED_SHORT, 0, (GLsizei)objects.size());
     glBindVertexArray(0);
     
+    if (msaa) {
+        // Resolve straight into the window
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, msaaFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    } else if (antiAliasMode == AA_FXAA) {
+        pickingDirty = false;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDisable(GL_DEPTH_TEST);
+        fxaaShaderProgram.use();
+        fxaaShaderProgram.setVec2(fxaaTexelSize, 1.0f / windowWidth, 1.0f / windowHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, sceneColorTexture);
+        glBindVertexArray(presentVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    } else {
+        pickingDirty = false;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, windowWidth, windowHeight,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    if (dragging && dragExtent >= DRAG_THRESHOLD) {
+        drawSelectionOverlay();
+    }
+    
+    endFrameTimer(start);
     glutSwapBuffers();
 }
 
@@ -548,59 +1396,184 @@ void init() {
     unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
     unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
     
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
+    shaderProgram.link(vertexShader, fragmentShader);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
     
+    phong.ka = shaderProgram.location("ka");
+    phong.kd = shaderProgram.location("kd");
+    phong.ks = shaderProgram.location("ks");
+    phong.shininess = shaderProgram.location("shininess");
+    phong.positionMin = shaderProgram.location("positionMin");
+    phong.positionScale = shaderProgram.location("positionScale");
+    phong.highlightedObject = shaderProgram.location("highlightedObject");
+    
     // Compile picking shaders
     unsigned int pickingVertexShader = compileShader(GL_VERTEX_SHADER, pickingVertexShaderSource);
     unsigned int pickingFragmentShader = compileShader(GL_FRAGMENT_SHADER, pickingFragmentShaderSource);
     
-    pickingShaderProgram = glCreateProgram();
-    glAttachShader(pickingShaderProgram, pickingVertexShader);
-    glAttachShader(pickingShaderProgram, pickingFragmentShader);
-    glLinkProgram(pickingShaderProgram);
-    
+    pickingShaderProgram.link(pickingVertexShader, pickingFragmentShader);
     glDeleteShader(pickingVertexShader);
     glDeleteShader(pickingFragmentShader);
     
-    // Create meshes
-    createMesh(0, 0.8f, -2.0f, 0.0f, 0.0f);
-    createMesh(1, 0.8f, 0.0f, 0.0f, 0.0f);
-    createMesh(2, 0.8f, 2.0f, 0.0f, 0.0f);
+    picking.positionMin = pickingShaderProgram.location("positionMin");
+    picking.positionScale = pickingShaderProgram.location("positionScale");
+    
+    // Compile FXAA shaders (sceneColor stays on texture unit 0)
+    unsigned int fxaaVertexShader = compileShader(GL_VERTEX_SHADER, fullScreenVertexShaderSource);
+    unsigned int fxaaFragmentShader = compileShader(GL_FRAGMENT_SHADER, fxaaFragmentShaderSource);
+    
+    fxaaShaderProgram.link(fxaaVertexShader, fxaaFragmentShader);
+    glDeleteShader(fxaaVertexShader);
+    glDeleteShader(fxaaFragmentShader);
+    fxaaTexelSize = fxaaShaderProgram.location("texelSize");
+    glGenVertexArrays(1, &presentVAO);
+    
+    // Compile overlay shaders and the outline's buffer (window x, y pairs)
+    unsigned int overlayVertexShader = compileShader(GL_VERTEX_SHADER, overlayVertexShaderSource);
+    unsigned int overlayFragmentShader = compileShader(GL_FRAGMENT_SHADER, overlayFragmentShaderSource);
+    
+    overlayShaderProgram.link(overlayVertexShader, overlayFragmentShader);
+    glDeleteShader(overlayVertexShader);
+    glDeleteShader(overlayFragmentShader);
+    overlayViewportSize = overlayShaderProgram.location("viewportSize");
+    
+    glGenVertexArrays(1, &overlayVAO);
+    glGenBuffers(1, &overlayVBO);
+    glBindVertexArray(overlayVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, overlayVBO);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
     
-    // Create FBO
+    frameUniforms.create();
+    
+    // Shared cube and the per-object instances
+    createCubeMesh(0.8f);
+    buildScene(objectCount);
+    
+    // Create FBO and the readback buffers of asynchronous picks
     createFBO();
+    createPickBuffers();
+    
+    // GPU timers of the frame-time counters
+    glGenQueries(FRAME_QUERY_COUNT, frameQueries);
+    for (int i = 0; i < FRAME_QUERY_COUNT; i++) {
+        frameQueryMode[i] = -1;
+    }
     
     // Initialize random seed
     srand(time(nullptr));
     
     std::cout << "\n=== Anti-aliasing and Picking ===" << std::endl;
     std::cout << "Left click: Select object (changes color)" << std::endl;
-    std::cout << "A/a: Toggle anti-aliasing" << std::endl;
+    std::cout << "Left drag: Select objects in a rectangle (Shift: lasso)" << std::endl;
+    std::cout << "Mouse move: Highlight object under the cursor" << std::endl;
+    std::cout << "A/a: Cycle anti-aliasing (off, MSAA, FXAA)" << std::endl;
+    std::cout << "M/m: Cycle MSAA samples (2, 4, 8)" << std::endl;
+    std::cout << "T/t: Print frame times per anti-aliasing mode" << std::endl;
+    std::cout << "C/c: Toggle CPU ray-cast picking" << std::endl;
+    std::cout << "V/v: Toggle fully-visible-only region selection" << std::endl;
     std::cout << "Arrow keys: Rotate camera" << std::endl;
+    std::cout << "Page Up/Down: Zoom in/out" << std::endl;
     std::cout << "R/r: Reset view" << std::endl;
     std::cout << "ESC: Exit" << std::endl;
 }
 
+// Compare CPU ray picks with id buffer picks over a grid of window pixels
+// and time both. Needs the GL context, so it runs after init()
+// (--verify-picking) instead of opening the interactive window.
+void verifyPicking(int step) {
+    std::cout << "\n=== Picking: ray cast vs id buffer (" << objects.size() << " objects, pixel step "
+              << step << ") ===" << std::endl;
+    
+    // Render the id buffer once up front so the picks below time readback only
+    pickingDirty = true;
+    auto renderStart = std::chrono::high_resolution_clock::now();
+    pickPixel(0, 0);
+    double renderMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - renderStart).count();
+    
+    size_t pixels = 0, hits = 0, objectMismatches = 0, triangleMismatches = 0;
+    double rayUs = 0.0, bufferUs = 0.0;
+    for (int y = step / 2; y < windowHeight; y += step) {
+        for (int x = step / 2; x < windowWidth; x += step) {
+            auto start = std::chrono::high_resolution_clock::now();
+            RayHit hit = rayPick(x, y);
+            auto middle = std::chrono::high_resolution_clock::now();
+            PickResult pick = pickPixel(x, y);
+            auto end = std::chrono::high_resolution_clock::now();
+            rayUs += std::chrono::duration<double, std::micro>(middle - start).count();
+            bufferUs += std::chrono::duration<double, std::micro>(end - middle).count();
+            
+            pixels++;
+            hits += (pick.objectId >= 0);
+            if (hit.objectId != pick.objectId) {
+                if (objectMismatches < 5) {
+                    std::cout << "  (" << x << ", " << y << "): ray object " << hit.objectId
+                              << ", id buffer object " << pick.objectId << std::endl;
+                }
+                objectMismatches++;
+            } else if (hit.triangleId != pick.triangleId) {
+                triangleMismatches++;
+            }
+        }
+    }
+    
+    std::cout << "  " << pixels << " pixels, " << hits << " on objects: " << objectMismatches
+              << " object mismatches, " << triangleMismatches << " triangle mismatches" << std::endl;
+    std::cout << "  Ray cast " << rayUs / pixels << " us per pick, id buffer readback " << bufferUs / pixels
+              << " us per pick (id buffer render " << renderMs << " ms)" << std::endl;
+}
+
 int main(int argc, char** argv) {
+    int verifyStep = 0;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--objects" && a + 1 < argc) {
+            objectCount = std::max(1, atoi(argv[++a]));
+        } else if (arg == "--sync-picks") {
+            syncPicks = true;
+        } else if (arg == "--cpu-picking") {
+            cpuPicking = true;
+        } else if (arg == "--fully-visible") {
+            fullyVisibleOnly = true;
+        } else if (arg == "--msaa" && a + 1 < argc) {
+            antiAliasMode = AA_MSAA;
+            int samples = atoi(argv[++a]);
+            msaaSamples = samples >= 8 ? 8 : samples >= 4 ? 4 : 2;
+        } else if (arg == "--fxaa") {
+            antiAliasMode = AA_FXAA;
+        } else if (arg == "--verify-picking") {
+            verifyStep = 8;
+            if (a + 1 < argc && atoi(argv[a + 1]) > 0) {
+                verifyStep = atoi(argv[++a]);
+            }
+        }
+    }
+    
     glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_MULTISAMPLE);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);  // Frames are rendered off-screen and copied in
     glutInitWindowSize(800, 600);
     glutInitWindowPosition(100, 100);
     glutCreateWindow("Assignment 4 Part 2 - Anti-aliasing and Picking");
     
     init();
     
+    // Picking check, needs the window's context
+    if (verifyStep > 0) {
+        verifyPicking(verifyStep);
+        return 0;
+    }
+    
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutKeyboardFunc(keyboard);
     glutSpecialFunc(specialKeys);
     glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+    glutPassiveMotionFunc(passiveMotion);
     
     glutMainLoop();
     
@@ -3,12 +3,46 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include "bezier_surface.h"
+#include "bezier_forward_difference.h"
+#include "bezier_tess_shaders.h"
+#include "parametric_mesh.h"
+#include "mesh_cache.h"
+#include "vertex_compression.h"
+#include "mesh_optimizer.h"
+#include "procedural_texture.h"
+#include "simd_math.h"
+#include "shader_program.h"
 
 // Global variables
-unsigned int shaderProgram;
+ShaderProgram shaderProgram;
+FrameUniformBuffer frameUniforms;
+
+// Per-object uniform locations, resolved once after linking
+struct PhongUniforms {
+    int model, ka, kd, ks, shininess, textureSampler;
+    int positionMin, positionScale;
+} phong;
 unsigned int patchVAO, patchVBO, patchEBO;
+MeshBounds patchBounds;  // Decode transform for the compressed positions in patchVBO
 unsigned int textureID;
 
+// Hardware tessellation program (OpenGL 4.0) over tessPatchVBO, which holds
+// 16 control points per patch
+ShaderProgram tessShaderProgram;
+unsigned int tessPatchVAO, tessPatchVBO;
+
+struct TessUniforms {
+    int model, ka, kd, ks, shininess, textureSampler;
+    int viewportSize, pixelsPerSegment, maxTessLevel;
+} tess;
+
+int textureWidth = 512, textureHeight = 512;  // Level 0 size (--texture-size N or WxH)
+
 // Control points (4x4 grid)
 std::vector<float> controlPoints = {
     // Row 0
@@ -35,6 +69,39 @@ std::vector<float> controlPoints = {
 
 int resolution = 12;
 
+// Patches loaded from file (--patches); a single patch replaces controlPoints,
+// several are tessellated together into one buffer
+const char* patchFile = "src/control_points.txt";
+BezierSurface surface;
+std::vector<MeshLod> patchLods;  // LOD chain packed into patchVBO / patchEBO (parametric_mesh.h)
+float patchRadius = 0.0f;  // Bounding radius of level 0, for LOD selection
+int patchLodLevel = -1;  // Level drawn last frame, for reporting
+int windowWidth = 800;
+int windowHeight = 600;
+GLenum patchIndexType = GL_UNSIGNED_INT;  // GL_UNSIGNED_SHORT when the vertex count allows
+
+// Startup mesh cache directory (--no-mesh-cache disables it)
+const char* meshCacheDir = "mesh_cache";
+bool meshCacheEnabled = true;
+
+// Tessellation evaluator
+enum EvaluatorMode {
+    EVAL_DIRECT = 0,
+    EVAL_FORWARD_DIFFERENCE = 1
+};
+EvaluatorMode evaluatorMode = EVAL_DIRECT;
+
+// Forward differencing re-seeds from the exact polynomial every N steps (0 = never)
+int forwardDiffReseedInterval = 16;
+
+// GPU tessellation (H key, --gpu-tessellation): tessellation shaders evaluate
+// the patches with levels chosen from their projected size on screen, and
+// texture coordinates come from gl_TessCoord
+bool gpuTessellation = false;
+bool gpuTessellationSupported = false;
+float tessPixelsPerSegment = 8.0f;  // Target edge length in pixels (--tess-pixels)
+float maxTessLevel = 64.0f;         // Clamped to GL_MAX_TESS_GEN_LEVEL at init
+
 // Camera parameters
 float cameraAngleX = 30.0f;
 float cameraAngleY = 45.0f;
@@ -52,15 +119,22 @@ float shininess = 32.0f;
 // Shader source code
 const char* vertexShaderSource = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoord;
+layout (location = 0) in vec4 aPos;       // unorm16 within the mesh bounds
+layout (location = 1) in vec2 aNormal;    // snorm16 octahedral
+layout (location = 2) in vec2 aTexCoord;  // unorm16
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+uniform vec3 positionMin;
+uniform vec3 positionScale;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -68,19 +142,30 @@ out vec2 TexCoord;
 out vec3 LightDir;
 out vec3 ViewDir;
 
+// Octahedral normal decode (octDecode in vertex_compression.h)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    vec3 position = positionMin + aPos.xyz * positionScale;
+    FragPos = vec3(model * vec4(position, 1.0));
+    Normal = mat3(transpose(inverse(model))) * octDecode(aNormal);
     TexCoord = aTexCoord;
     
-    vec3 worldLightPos = lightPos;
-    vec3 worldViewPos = viewPos;
+    vec3 worldLightPos = lightPos.xyz;
+    vec3 worldViewPos = viewPos.xyz;
     
     LightDir = normalize(worldLightPos - FragPos);
     ViewDir = normalize(worldViewPos - FragPos);
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
 )";
 
@@ -96,9 +181,17 @@ uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float shininess;
-uniform vec3 lightColor;
 uniform sampler2D textureSampler;
 
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
 out vec4 FragColor;
 
 void main()
@@ -111,16 +204,16 @@ void main()
     vec3 viewDir = normalize(ViewDir);
     
     // Ambient component
-    vec3 ambient = ka * lightColor * textureColor;
+    vec3 ambient = ka * lightColor.rgb * textureColor;
     
     // Diffuse component (texture replaces constant diffuse color)
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = kd * diff * lightColor * textureColor;
+    vec3 diffuse = kd * diff * lightColor.rgb * textureColor;
     
     // Specular component
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = ks * spec * lightColor;
+    vec3 specular = ks * spec * lightColor.rgb;
     
     // Combine components
     vec3 result = ambient + diffuse + specular;
@@ -228,8 +321,9 @@ void computeNormal(float u, float v, float* normal) {
     }
 }
 
-// Generate procedural texture (interesting pattern)
-void generateProceduralTexture(int width, int height, unsigned char* data) {
+// Per-texel procedural texture (interesting pattern), level 0 only; the
+// reference for the tiled generator in procedural_texture.h (--benchmark)
+void generateProceduralTextureReference(int width, int height, unsigned char* data) {
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
             int idx = (y * width + x) * 3;
@@ -263,33 +357,49 @@ void generateProceduralTexture(int width, int height, unsigned char* data) {
     }
 }
 
+// Procedural texture with its full mip chain, generated on all cores and
+// sampled trilinearly so the patch does not shimmer when it is small
 void createTexture() {
-    const int width = 512;
-    const int height = 512;
-    unsigned char* data = new unsigned char[width * height * 3];
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    int width = std::min(textureWidth, (int)maxSize);
+    int height = std::min(textureHeight, (int)maxSize);
     
-    generateProceduralTexture(width, height, data);
+    auto start = std::chrono::high_resolution_clock::now();
+    TextureMipChain chain;
+    generateProceduralTexture(width, height, std::max(1u, std::thread::hardware_concurrency()), chain);
+    auto end = std::chrono::high_resolution_clock::now();
     
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
     
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    // RGB rows are tightly packed, not padded to 4 bytes
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t level = 0; level < chain.levels.size(); level++) {
+        glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGB8, chain.widths[level], chain.heights[level], 0,
+                     GL_RGB, GL_UNSIGNED_BYTE, chain.levels[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)chain.levels.size() - 1);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     
-    delete[] data;
+    std::cout << "Texture: " << width << "x" << height << ", " << chain.levels.size() << " mip levels in "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
 }
 
-void generatePatchMesh() {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
+// Direct tessellation: evaluates every vertex with the per-sample evaluators
+// (position, normal, texture coordinates; 8 floats per vertex)
+void tessellatePatchReference(int res, std::vector<float>& vertices) {
+    vertices.clear();
+    vertices.reserve((res + 1) * (res + 1) * 8);
     
-    for (int j = 0; j <= resolution; j++) {
-        float v = (float)j / resolution;
-        for (int i = 0; i <= resolution; i++) {
-            float u = (float)i / resolution;
+    for (int j = 0; j <= res; j++) {
+        float v = (float)j / res;
+        for (int i = 0; i <= res; i++) {
+            float u = (float)i / res;
             
             // Position
             float pos[3];
@@ -310,24 +420,55 @@ void generatePatchMesh() {
             vertices.push_back(v);
         }
     }
-    
-    // Generate indices
-    for (int j = 0; j < resolution; j++) {
-        for (int i = 0; i < resolution; i++) {
-            int topLeft = j * (resolution + 1) + i;
-            int topRight = topLeft + 1;
-            int bottomLeft = (j + 1) * (resolution + 1) + i;
-            int bottomRight = bottomLeft + 1;
-            
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-            
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
+}
+
+// Tessellate the LOD chain (resolution, then halved per level) into
+// patchLods, one (res+1)^2 vertex grid per patch and level, indexed as
+// triangle strips (mesh_optimizer.h); report prints the statistics
+void buildPatchMesh(std::vector<float>& vertices, std::vector<unsigned int>& indices, bool report = false) {
+    if (surface.patchCount() > 1) {
+        generateBezierLods(surface, resolution, true, std::max(1u, std::thread::hardware_concurrency()),
+                           patchLods, vertices, indices);
+    } else {
+        buildLodChain(1, resolution, resolution, patchLods);
+        vertices.resize(lodChainVertexCount(patchLods) * 8);
+        std::vector<float> level;
+        for (size_t l = 0; l < patchLods.size(); l++) {
+            if (evaluatorMode == EVAL_FORWARD_DIFFERENCE) {
+                tessellatePatchForwardDifference(controlPoints.data(), patchLods[l].columns, forwardDiffReseedInterval,
+                                                 true, level);
+            } else {
+                tessellatePatchReference(patchLods[l].columns, level);
+            }
+            std::copy(level.begin(), level.end(), vertices.begin() + patchLods[l].firstVertex * 8);
         }
+        generateLodIndices(1, patchLods, indices);
+    }
+    if (report) {
+        printStripStats("patch mesh", indices.data(), patchLods[0].indexCount, patchLods[0].vertexCount);
+        printLodChain("patch mesh", patchLods);
+    }
+}
+
+// Pack a position/normal/uv LOD chain laid out as patchLods into the upload
+// format: compressed vertices (vertex_compression.h), plus 16-bit indices
+// when level 0 fits. Indices are local to each level, so level 0 alone
+// decides the width. Sets patchBounds; returns the index width in bytes.
+size_t packPatchMesh(const std::vector<float>& vertices, const std::vector<unsigned int>& indices, bool report,
+                     std::vector<uint16_t>& packedVertices, std::vector<uint16_t>& packedIndices) {
+    patchBounds = compressMesh("patch mesh", vertices.data(), vertices.size() / 8, 8, packedVertices, report);
+    packedIndices.clear();
+    if (!indicesFit16(patchLods[0].vertexCount)) {
+        return sizeof(unsigned int);
     }
+    packIndices16(indices.data(), indices.size(), packedIndices);
+    return sizeof(uint16_t);
+}
+
+// Upload a packed LOD chain as is; patchBounds must already describe it
+void uploadPatchMesh(const uint16_t* vertices, size_t vertexCount, const void* indices, size_t indexCount,
+                     size_t indexBytes) {
+    patchRadius = compressedBoundingRadius(vertices, patchLods[0].vertexCount, true, patchBounds);
     
     if (patchVAO == 0) {
         glGenVertexArrays(1, &patchVAO);
@@ -337,82 +478,158 @@ void generatePatchMesh() {
     
     glBindVertexArray(patchVAO);
     
+    GLsizei stride = compressedVertexShorts(true) * sizeof(uint16_t);
     glBindBuffer(GL_ARRAY_BUFFER, patchVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * stride, vertices, GL_DYNAMIC_DRAW);
     
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_DYNAMIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexBytes, indices, GL_DYNAMIC_DRAW);
+    patchIndexType = (indexBytes == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    glPrimitiveRestartIndex(stripRestartIndex(patchIndexType == GL_UNSIGNED_SHORT));
     
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    // Position (unorm16, decoded with patchBounds)
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)COMPRESSED_POSITION_OFFSET);
     glEnableVertexAttribArray(0);
     
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    // Normal (octahedral snorm16)
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)COMPRESSED_NORMAL_OFFSET);
     glEnableVertexAttribArray(1);
     
-    // Texture coordinates
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    // Texture coordinates (unorm16)
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)COMPRESSED_TEXCOORD_OFFSET);
     glEnableVertexAttribArray(2);
     
     glBindVertexArray(0);
 }
 
-// Matrix functions
-void createIdentityMatrix(float* matrix) {
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
-    }
+// Build, pack and upload the patch mesh; the packed blobs are returned for
+// the mesh cache
+size_t generatePatchMesh(bool report, std::vector<uint16_t>& packedVertices, std::vector<uint16_t>& packedIndices,
+                         std::vector<unsigned int>& indices) {
+    std::vector<float> vertices;
+    buildPatchMesh(vertices, indices, report);
+    size_t indexBytes = packPatchMesh(vertices, indices, report, packedVertices, packedIndices);
+    const void* indexData = packedIndices.empty() ? (const void*)indices.data() : (const void*)packedIndices.data();
+    uploadPatchMesh(packedVertices.data(), vertices.size() / 8, indexData, indices.size(), indexBytes);
+    return indexBytes;
 }
 
-void createLookAtMatrix(float* matrix, float eyeX, float eyeY, float eyeZ,
-                       float centerX, float centerY, float centerZ,
-                       float upX, float upY, float upZ) {
-    float f[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
-    float len = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
-    if (len > 1e-6f) {
-        f[0] /= len; f[1] /= len; f[2] /= len;
+void generatePatchMesh() {
+    std::vector<uint16_t> packedVertices, packedIndices;
+    std::vector<unsigned int> indices;
+    generatePatchMesh(false, packedVertices, packedIndices, indices);
+}
+
+// Initial mesh: upload straight from a mapped cache file keyed by the
+// control points and tessellation settings, or generate and cache it
+void loadPatchMesh() {
+    std::vector<uint16_t> packedVertices, packedIndices;
+    std::vector<unsigned int> indices;
+    if (!meshCacheEnabled) {
+        generatePatchMesh(true, packedVertices, packedIndices, indices);
+        return;
     }
     
-    float s[3] = {
-        f[1] * upZ - f[2] * upY,
-        f[2] * upX - f[0] * upZ,
-        f[0] * upY - f[1] * upX
-    };
-    len = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
-    if (len > 1e-6f) {
-        s[0] /= len; s[1] /= len; s[2] /= len;
+    size_t vertexBytes = compressedVertexShorts(true) * sizeof(uint16_t);
+    uint64_t key = meshCacheHashValue(MESH_CACHE_HASH_SEED, resolution);
+    key = meshCacheHashValue(key, MAX_LOD_LEVELS);
+    key = meshCacheHashValue(key, MIN_LOD_SEGMENTS);
+    if (surface.patchCount() > 1) {
+        // generateBezierLods has no evaluator settings
+        key = meshCacheHash(key, surface.x.data(), surface.x.size() * sizeof(float));
+        key = meshCacheHash(key, surface.y.data(), surface.y.size() * sizeof(float));
+        key = meshCacheHash(key, surface.z.data(), surface.z.size() * sizeof(float));
+    } else {
+        key = meshCacheHashValue(key, (int)evaluatorMode);
+        key = meshCacheHashValue(key, forwardDiffReseedInterval);
+        key = meshCacheHash(key, controlPoints.data(), controlPoints.size() * sizeof(float));
+    }
+    std::string path = meshCachePath(meshCacheDir, "bezier_textured", key);
+    
+    // The chain layout follows from the resolution and patch count
+    buildLodChain(std::max(1, surface.patchCount()), resolution, resolution, patchLods);
+    MappedMesh cached;
+    if (mapMeshCache(path, key, vertexBytes, cached) && cached.vertexCount == lodChainVertexCount(patchLods) &&
+        cached.indexCount == lodChainIndexCount(patchLods)) {
+        patchBounds = cached.bounds;
+        uploadPatchMesh(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount,
+                        cached.layout.indexBytes);
+        std::cout << "Loaded mesh from cache: " << path << std::endl;
+        printLodChain("patch mesh", patchLods);
+        unmapMeshCache(cached);
+        return;
     }
+    unmapMeshCache(cached);
     
-    float u[3] = {
-        s[1] * f[2] - s[2] * f[1],
-        s[2] * f[0] - s[0] * f[2],
-        s[0] * f[1] - s[1] * f[0]
-    };
-    
-    createIdentityMatrix(matrix);
-    matrix[0] = s[0]; matrix[4] = s[1]; matrix[8] = s[2];
-    matrix[1] = u[0]; matrix[5] = u[1]; matrix[9] = u[2];
-    matrix[2] = -f[0]; matrix[6] = -f[1]; matrix[10] = -f[2];
-    matrix[12] = -(s[0]*eyeX + s[1]*eyeY + s[2]*eyeZ);
-    matrix[13] = -(u[0]*eyeX + u[1]*eyeY + u[2]*eyeZ);
-    matrix[14] = f[0]*eyeX + f[1]*eyeY + f[2]*eyeZ;
+    size_t indexBytes = generatePatchMesh(true, packedVertices, packedIndices, indices);
+    const MeshLayout layout = {(uint16_t)vertexBytes, (uint16_t)indexBytes};
+    const void* indexData = packedIndices.empty() ? (const void*)indices.data() : (const void*)packedIndices.data();
+    writeMeshCache(path, key, layout, patchBounds, packedVertices.data(),
+                   packedVertices.size() / compressedVertexShorts(true), indexData, indices.size());
 }
 
-void createPerspectiveMatrix(float* matrix, float fovy, float aspect, float near, float far) {
-    float f = 1.0f / tan(fovy * M_PI / 360.0f);
+// Upload every patch's control points for the GPU path, 16 xyz per patch
+void generateTessellationPatches() {
+    std::vector<float> points;
+    if (surface.patchCount() > 1) {
+        points.resize(surface.patchCount() * 48);
+        for (int p = 0; p < surface.patchCount(); p++) {
+            surface.getPatch(p, &points[p * 48]);
+        }
+    } else {
+        points = controlPoints;
+    }
     
-    createIdentityMatrix(matrix);
-    matrix[0] = f / aspect;
-    matrix[5] = f;
-    matrix[10] = (far + near) / (near - far);
-    matrix[11] = -1.0f;
-    matrix[14] = (2.0f * far * near) / (near - far);
-    matrix[15] = 0.0f;
+    glGenVertexArrays(1, &tessPatchVAO);
+    glGenBuffers(1, &tessPatchVBO);
+    glBindVertexArray(tessPatchVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, tessPatchVBO);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(float), points.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
 }
 
 void keyboard(unsigned char key, int x, int y) {
     switch(key) {
+        case 'm':
+        case 'M':
+            if (surface.patchCount() > 1) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            evaluatorMode = (evaluatorMode == EVAL_DIRECT) ? EVAL_FORWARD_DIFFERENCE : EVAL_DIRECT;
+            generatePatchMesh();
+            std::cout << "Evaluator: " << (evaluatorMode == EVAL_DIRECT ? "direct" : "forward differencing") << std::endl;
+            break;
+        case 'n':
+            if (surface.patchCount() > 1) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            forwardDiffReseedInterval = (forwardDiffReseedInterval == 0) ? 1 : std::min(1024, forwardDiffReseedInterval * 2);
+            generatePatchMesh();
+            std::cout << "Forward-differencing re-seed interval: " << forwardDiffReseedInterval << std::endl;
+            break;
+        case 'N':
+            if (surface.patchCount() > 1) {
+                std::cout << "The evaluator applies to single-patch files only" << std::endl;
+                break;
+            }
+            forwardDiffReseedInterval /= 2;
+            generatePatchMesh();
+            std::cout << "Forward-differencing re-seed interval: " << forwardDiffReseedInterval
+                      << (forwardDiffReseedInterval == 0 ? " (never)" : "") << std::endl;
+            break;
+        case 'h':
+        case 'H':
+            if (!gpuTessellationSupported) {
+                std::cout << "GPU tessellation needs OpenGL 4.0 tessellation shaders" << std::endl;
+                break;
+            }
+            gpuTessellation = !gpuTessellation;
+            std::cout << "Tessellation path: " << (gpuTessellation ? "GPU (screen-space adaptive)" : "CPU") << std::endl;
+            break;
         case 'r':
         case 'R':
             cameraAngleX = 30.0f;
@@ -441,6 +658,12 @@ void specialKeys(int key, int x, int y) {
         case GLUT_KEY_RIGHT:
             cameraAngleY += delta;
             break;
+        case GLUT_KEY_PAGE_UP:
+            cameraDistance = std::max(2.0f, cameraDistance * 0.8f);
+            break;
+        case GLUT_KEY_PAGE_DOWN:
+            cameraDistance = std::min(80.0f, cameraDistance * 1.25f);
+            break;
     }
     glutPostRedisplay();
 }
@@ -452,39 +675,70 @@ void display() {
     float camY = cameraDistance * sin(cameraAngleX * M_PI / 180.0f);
     float camZ = cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
     
-    float model[16], view[16], projection[16];
-    createIdentityMatrix(model);
-    createLookAtMatrix(view, camX, camY, camZ, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-    createPerspectiveMatrix(projection, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    Mat4 model = Mat4::identity();
+    Mat4 view = Mat4::lookAt(Vec3{camX, camY, camZ}, Vec3{0.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f});
+    Mat4 projection = Mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
     
-    glUseProgram(shaderProgram);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), lightPos[0], lightPos[1], lightPos[2]);
-    glUniform3f(glGetUniformLocation(shaderProgram, "viewPos"), camX, camY, camZ);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderProgram, "shininess"), shininess);
+    FrameUniforms frame;
+    float viewPos[3] = {camX, camY, camZ};
+    float lightColor[3] = {1.0f, 1.0f, 1.0f};
+    setFrameUniforms(frame, view.m, projection.m, lightPos, viewPos, lightColor);
+    frameUniforms.update(frame);
     
     // Bind texture
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, textureID);
-    glUniform1i(glGetUniformLocation(shaderProgram, "textureSampler"), 0);
     
-    glBindVertexArray(patchVAO);
-    int numIndices = resolution * resolution * 6;
-    glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    if (gpuTessellation) {
+        tessShaderProgram.use();
+        tessShaderProgram.setMat4(tess.model, model.m);
+        tessShaderProgram.setFloat(tess.ka, ka);
+        tessShaderProgram.setFloat(tess.kd, kd);
+        tessShaderProgram.setFloat(tess.ks, ks);
+        tessShaderProgram.setFloat(tess.shininess, shininess);
+        tessShaderProgram.setInt(tess.textureSampler, 0);
+        tessShaderProgram.setVec2(tess.viewportSize, (float)windowWidth, (float)windowHeight);
+        tessShaderProgram.setFloat(tess.pixelsPerSegment, tessPixelsPerSegment);
+        tessShaderProgram.setFloat(tess.maxTessLevel, maxTessLevel);
+        
+        glPatchParameteri(GL_PATCH_VERTICES, 16);
+        glBindVertexArray(tessPatchVAO);
+        glDrawArrays(GL_PATCHES, 0, std::max(1, surface.patchCount()) * 16);
+        glBindVertexArray(0);
+    } else {
+        shaderProgram.use();
+        
+        shaderProgram.setMat4(phong.model, model.m);
+        shaderProgram.setFloat(phong.ka, ka);
+        shaderProgram.setFloat(phong.kd, kd);
+        shaderProgram.setFloat(phong.ks, ks);
+        shaderProgram.setFloat(phong.shininess, shininess);
+        shaderProgram.setVec3(phong.positionMin, patchBounds.min[0], patchBounds.min[1], patchBounds.min[2]);
+        shaderProgram.setVec3(phong.positionScale, patchBounds.scale[0], patchBounds.scale[1], patchBounds.scale[2]);
+        shaderProgram.setInt(phong.textureSampler, 0);
+        
+        // Level from the projected size of the surface at cameraDistance
+        int level = selectLod(patchLods, patchRadius, cameraDistance, 45.0f, windowHeight);
+        const MeshLod& lod = patchLods[level];
+        if (level != patchLodLevel) {
+            patchLodLevel = level;
+            std::cout << "Level of detail " << level << ": " << lod.columns << "x" << lod.rows << " per patch ("
+                      << lod.triangleCount << " triangles)" << std::endl;
+        }
+        size_t indexSize = (patchIndexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(unsigned int);
+        glBindVertexArray(patchVAO);
+        glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, (GLsizei)lod.indexCount, patchIndexType,
+                                 (void*)(lod.firstIndex * indexSize), (GLint)lod.firstVertex);
+        glBindVertexArray(0);
+    }
     
     glutSwapBuffers();
 }
 
 void reshape(int width, int height) {
     glViewport(0, 0, width, height);
+    windowWidth = std::max(1, width);
+    windowHeight = std::max(1, height);
 }
 
 unsigned int compileShader(unsigned int type, const char* source) {
@@ -503,6 +757,38 @@ unsigned int compileShader(unsigned int type, const char* source) {
     return shader;
 }
 
+// Compile and link the tessellation program with the textured Phong fragment
+// shader; false if the driver rejects it
+bool createTessellationProgram() {
+    std::vector<unsigned int> shaders;
+    shaders.push_back(compileShader(GL_VERTEX_SHADER, bezierTessVertexShaderSource));
+    shaders.push_back(compileShader(GL_TESS_CONTROL_SHADER, bezierTessControlShaderSource));
+    shaders.push_back(compileShader(GL_TESS_EVALUATION_SHADER, bezierTessEvaluationShaderSource));
+    shaders.push_back(compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource));
+    bool linked = tessShaderProgram.link(shaders);
+    for (size_t i = 0; i < shaders.size(); i++) {
+        glDeleteShader(shaders[i]);
+    }
+    if (!linked) {
+        return false;
+    }
+    
+    tess.model = tessShaderProgram.location("model");
+    tess.ka = tessShaderProgram.location("ka");
+    tess.kd = tessShaderProgram.location("kd");
+    tess.ks = tessShaderProgram.location("ks");
+    tess.shininess = tessShaderProgram.location("shininess");
+    tess.textureSampler = tessShaderProgram.location("textureSampler");
+    tess.viewportSize = tessShaderProgram.location("viewportSize");
+    tess.pixelsPerSegment = tessShaderProgram.location("pixelsPerSegment");
+    tess.maxTessLevel = tessShaderProgram.location("maxTessLevel");
+    
+    int maxLevel = 64;
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+    maxTessLevel = std::min(maxTessLevel, (float)maxLevel);
+    return true;
+}
+
 void init() {
     GLenum err = glewInit();
     if (err != GLEW_OK) {
@@ -511,29 +797,117 @@ void init() {
     }
     
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PRIMITIVE_RESTART);  // Patch mesh is strips; uploadPatchMesh sets the restart index
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     
     unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
     unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
     
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
+    shaderProgram.link(vertexShader, fragmentShader);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
     
+    phong.model = shaderProgram.location("model");
+    phong.ka = shaderProgram.location("ka");
+    phong.kd = shaderProgram.location("kd");
+    phong.ks = shaderProgram.location("ks");
+    phong.shininess = shaderProgram.location("shininess");
+    phong.textureSampler = shaderProgram.location("textureSampler");
+    phong.positionMin = shaderProgram.location("positionMin");
+    phong.positionScale = shaderProgram.location("positionScale");
+    frameUniforms.create();
+    
+    // Control points from file; keep the built-in patch if loading fails
+    if (loadBezierSurface(patchFile, surface)) {
+        surface.getPatch(0, controlPoints.data());
+        std::cout << "Loaded " << surface.patchCount() << " patch(es) from " << patchFile << std::endl;
+    } else {
+        surface.clear();
+    }
+    
+    // Hardware tessellation path; the CPU path stays the fallback
+    if (GLEW_VERSION_4_0 || GLEW_ARB_tessellation_shader) {
+        gpuTessellationSupported = createTessellationProgram();
+    }
+    if (gpuTessellation && !gpuTessellationSupported) {
+        std::cerr << "GPU tessellation unavailable, using the CPU path" << std::endl;
+        gpuTessellation = false;
+    }
+    
     createTexture();
-    generatePatchMesh();
+    loadPatchMesh();
+    if (gpuTessellationSupported) {
+        generateTessellationPatches();
+    }
     
     std::cout << "Assignment 4 Part 3a - Texture Mapped Bezier Patch" << std::endl;
     std::cout << "Arrow keys: Rotate camera" << std::endl;
+    std::cout << "Page Up/Down: Zoom in/out" << std::endl;
+    std::cout << "M/m: Toggle direct / forward-differencing evaluator" << std::endl;
+    std::cout << "N/n: Decrease/Increase forward-differencing re-seed interval" << std::endl;
+    std::cout << "H/h: Toggle CPU / GPU (tessellation shader) path" << std::endl;
     std::cout << "R/r: Reset view" << std::endl;
     std::cout << "ESC: Exit" << std::endl;
 }
 
+// Forward differencing accuracy and speed against the direct evaluator (run with --benchmark)
+void benchmarkForwardDifference() {
+    int resolutions[] = {12, 256, 1024};
+    benchmarkForwardDifference(controlPoints.data(), true, resolutions, 3, "direct",
+                               [](int res, std::vector<float>& vertices) { tessellatePatchReference(res, vertices); });
+}
+
+// Tiled generator (with mips) against the per-texel reference (level 0 only)
+void benchmarkProceduralTexture() {
+    std::cout << "\n=== Procedural texture: tiled SIMD generator vs per-texel reference ===" << std::endl;
+    
+    int sizes[] = {512, 2048, 8192};
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int size : sizes) {
+        std::vector<unsigned char> reference((size_t)size * size * 3);
+        TextureMipChain chain;
+        double referenceMs = timeMilliseconds(1, [&]() { generateProceduralTextureReference(size, size, reference.data()); });
+        double tiledMs = timeMilliseconds(1, [&]() { generateProceduralTexture(size, size, threads, chain); });
+        
+        int maxDifference = 0;
+        for (size_t n = 0; n < reference.size(); n++) {
+            maxDifference = std::max(maxDifference, std::abs((int)reference[n] - (int)chain.levels[0][n]));
+        }
+        std::cout << "  " << size << "x" << size << ": " << tiledMs << " ms for " << chain.levels.size()
+                  << " levels on " << threads << " thread(s) (reference " << referenceMs
+                  << " ms, level 0 only), max difference " << maxDifference << "/255" << std::endl;
+    }
+}
+
 int main(int argc, char** argv) {
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--patches" && a + 1 < argc) {
+            patchFile = argv[++a];
+        } else if (arg == "--no-mesh-cache") {
+            meshCacheEnabled = false;
+        } else if (arg == "--resolution" && a + 1 < argc) {
+            resolution = std::max(4, std::min(1024, atoi(argv[++a])));
+        } else if (arg == "--texture-size" && a + 1 < argc) {
+            // N for a square texture, or WxH
+            int w = 0, h = 0;
+            int fields = sscanf(argv[++a], "%dx%d", &w, &h);
+            textureWidth = std::max(1, std::min(MAX_PROCEDURAL_TEXTURE_SIZE, w));
+            textureHeight = fields == 2 ? std::max(1, std::min(MAX_PROCEDURAL_TEXTURE_SIZE, h)) : textureWidth;
+        } else if (arg == "--gpu-tessellation") {
+            gpuTessellation = true;
+        } else if (arg == "--tess-pixels" && a + 1 < argc) {
+            tessPixelsPerSegment = std::max(1.0f, (float)atof(argv[++a]));
+        }
+    }
+    
+    // CPU-only benchmarks, no window needed
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        benchmarkForwardDifference();
+        benchmarkProceduralTexture();
+        return 0;
+    }
+    
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);
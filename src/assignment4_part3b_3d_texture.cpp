@@ -5,11 +5,50 @@
 #include <vector>
 #include <fstream>
 #include <sstream>
+#include <string>
+#include <chrono>
+#include "mesh_cache.h"
+#include "vertex_compression.h"
+#include "mesh_optimizer.h"
+#include "parametric_mesh.h"
+#include "simd_math.h"
+#include "shader_program.h"
 
 // Global variables
-unsigned int shaderProgram;
+ShaderProgram shaderProgram;
+FrameUniformBuffer frameUniforms;
+
+// Per-object uniform locations, resolved once after linking
+struct PhongUniforms {
+    int model, ka, kd, ks, shininess;
+    int positionMin, positionScale;
+} phong;
 unsigned int meshVAO, meshVBO, meshEBO;
-int meshIndexCount = 0;
+size_t meshVertexBytes = 0, meshIndexBytes = 0;  // Allocated sizes, reused while a mesh fits
+GLenum meshIndexType = GL_UNSIGNED_INT;  // GL_UNSIGNED_SHORT when the vertex count allows
+MeshBounds meshBounds;  // Decode transform for the compressed positions in meshVBO
+
+// Current shape (parametric_mesh.h) and its CPU arrays, reused across
+// regenerations. The arrays hold the whole LOD chain described by meshLods.
+ParametricParams meshParams = defaultParametricParams(SHAPE_TORUS);
+std::vector<MeshLod> meshLods;
+float meshRadius = 0.0f;  // Bounding radius of level 0, for LOD selection
+std::vector<float> meshVertices;
+std::vector<unsigned int> meshIndices;
+std::vector<uint16_t> meshPackedVertices, meshPackedIndices;
+const int MAX_MESH_SEGMENTS = 2048;
+int meshThreads = std::max(1u, std::thread::hardware_concurrency());
+
+// Copies of the mesh laid out on a square grid (--instances), each drawn at
+// the level of detail its distance calls for ('l' forces level 0)
+int meshInstances = 1;
+bool lodEnabled = true;
+std::vector<size_t> lodInstanceCounts;  // Instances per level in the last frame, for reporting
+int windowHeight = 600;
+
+// Startup mesh cache directory (--no-mesh-cache disables it)
+const char* meshCacheDir = "mesh_cache";
+bool meshCacheEnabled = true;
 
 // Camera parameters
 float cameraAngleX = 30.0f;
@@ -28,14 +67,21 @@ float shininess = 32.0f;
 // Shader source code
 const char* vertexShaderSource = R"(
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 0) in vec4 aPos;     // unorm16 within the mesh bounds
+layout (location = 1) in vec2 aNormal;  // snorm16 octahedral
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec3 lightPos;
-uniform vec3 viewPos;
+uniform vec3 positionMin;
+uniform vec3 positionScale;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
 
 out vec3 FragPos;
 out vec3 Normal;
@@ -43,19 +89,30 @@ out vec3 WorldPos;
 out vec3 LightDir;
 out vec3 ViewDir;
 
+// Octahedral normal decode (octDecode in vertex_compression.h)
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = positionMin + aPos.xyz * positionScale;
+    FragPos = vec3(model * vec4(position, 1.0));
     WorldPos = FragPos;  // World position for 3D texturing
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(model))) * octDecode(aNormal);
     
-    vec3 worldLightPos = lightPos;
-    vec3 worldViewPos = viewPos;
+    vec3 worldLightPos = lightPos.xyz;
+    vec3 worldViewPos = viewPos.xyz;
     
     LightDir = normalize(worldLightPos - FragPos);
     ViewDir = normalize(worldViewPos - FragPos);
     
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = projection * view * model * vec4(position, 1.0);
 }
 )";
 
@@ -71,7 +128,15 @@ uniform float ka;
 uniform float kd;
 uniform float ks;
 uniform float shininess;
-uniform vec3 lightColor;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
 
 out vec4 FragColor;
 
@@ -135,16 +200,16 @@ void main()
     vec3 viewDir = normalize(ViewDir);
     
     // Ambient component
-    vec3 ambient = ka * lightColor * textureColor;
+    vec3 ambient = ka * lightColor.rgb * textureColor;
     
     // Diffuse component (3D texture replaces constant diffuse color)
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = kd * diff * lightColor * textureColor;
+    vec3 diffuse = kd * diff * lightColor.rgb * textureColor;
     
     // Specular component
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
-    vec3 specular = ks * spec * lightColor;
+    vec3 specular = ks * spec * lightColor.rgb;
     
     // Combine components
     vec3 result = ambient + diffuse + specular;
@@ -152,207 +217,141 @@ void main()
 }
 )";
 
-// Create a torus mesh
-void createTorusMesh(float majorRadius, float minorRadius, int majorSegments, int minorSegments) {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    
-    // Generate vertices
-    for (int i = 0; i <= majorSegments; i++) {
-        float u = (float)i / majorSegments * 2.0f * M_PI;
-        float cosU = cos(u);
-        float sinU = sin(u);
-        
-        for (int j = 0; j <= minorSegments; j++) {
-            float v = (float)j / minorSegments * 2.0f * M_PI;
-            float cosV = cos(v);
-            float sinV = sin(v);
-            
-            // Position
-            float x = (majorRadius + minorRadius * cosV) * cosU;
-            float y = (majorRadius + minorRadius * cosV) * sinU;
-            float z = minorRadius * sinV;
-            
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-            
-            // Normal
-            float nx = cosV * cosU;
-            float ny = cosV * sinU;
-            float nz = sinV;
-            
-            vertices.push_back(nx);
-            vertices.push_back(ny);
-            vertices.push_back(nz);
-        }
+// Write data into buffer, reallocating only when it has outgrown the
+// allocated size
+void updateBuffer(GLenum target, unsigned int buffer, size_t& allocated, const void* data, size_t bytes) {
+    glBindBuffer(target, buffer);
+    if (bytes > allocated) {
+        glBufferData(target, bytes, data, GL_DYNAMIC_DRAW);
+        allocated = bytes;
+    } else {
+        glBufferSubData(target, 0, bytes, data);
     }
-    
-    // Generate indices
-    for (int i = 0; i < majorSegments; i++) {
-        for (int j = 0; j < minorSegments; j++) {
-            int first = i * (minorSegments + 1) + j;
-            int second = first + minorSegments + 1;
-            
-            indices.push_back(first);
-            indices.push_back(second);
-            indices.push_back(first + 1);
-            
-            indices.push_back(second);
-            indices.push_back(second + 1);
-            indices.push_back(first + 1);
-        }
-    }
-    
-    glGenVertexArrays(1, &meshVAO);
-    glGenBuffers(1, &meshVBO);
-    glGenBuffers(1, &meshEBO);
-    
-    glBindVertexArray(meshVAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-    
-    meshIndexCount = indices.size();
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    
-    glBindVertexArray(0);
 }
 
-// Alternative: Create a sphere mesh
-void createSphereMesh(float radius, int segments) {
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-    
-    // Generate vertices
-    for (int i = 0; i <= segments; i++) {
-        float theta = (float)i / segments * M_PI;
-        float sinTheta = sin(theta);
-        float cosTheta = cos(theta);
-        
-        for (int j = 0; j <= segments; j++) {
-            float phi = (float)j / segments * 2.0f * M_PI;
-            float sinPhi = sin(phi);
-            float cosPhi = cos(phi);
-            
-            // Position
-            float x = radius * sinTheta * cosPhi;
-            float y = radius * sinTheta * sinPhi;
-            float z = radius * cosTheta;
-            
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-            
-            // Normal (same as position for unit sphere, normalized)
-            vertices.push_back(x / radius);
-            vertices.push_back(y / radius);
-            vertices.push_back(z / radius);
-        }
+// Pack meshVertices / meshIndices (a position + normal LOD chain laid out as
+// meshLods) into meshPackedVertices / meshPackedIndices in the upload
+// format: compressed vertices (vertex_compression.h), plus 16-bit indices
+// when level 0 fits. Indices are local to each level, so level 0 alone
+// decides the width. Sets meshBounds; returns the index width in bytes.
+size_t packMesh(const char* name, bool report) {
+    meshBounds = compressMesh(name, meshVertices.data(), meshVertices.size() / 6, 6, meshPackedVertices, report);
+    meshPackedIndices.clear();
+    if (!indicesFit16(meshLods[0].vertexCount)) {
+        return sizeof(unsigned int);
     }
-    
-    // Generate indices
-    for (int i = 0; i < segments; i++) {
-        for (int j = 0; j < segments; j++) {
-            int first = i * (segments + 1) + j;
-            int second = first + segments + 1;
-            
-            indices.push_back(first);
-            indices.push_back(second);
-            indices.push_back(first + 1);
-            
-            indices.push_back(second);
-            indices.push_back(second + 1);
-            indices.push_back(first + 1);
-        }
+    packIndices16(meshIndices.data(), meshIndices.size(), meshPackedIndices);
+    return sizeof(uint16_t);
+}
+
+// Upload a packed LOD chain (strip indices per level) into meshVAO as is;
+// meshBounds must already describe it. The VAO and buffers are created once
+// and reused by every later mesh.
+void uploadMesh(const uint16_t* vertices, size_t vertexCount, const void* indices, size_t indexCount,
+                size_t indexBytes) {
+    meshRadius = compressedBoundingRadius(vertices, meshLods[0].vertexCount, false, meshBounds);
+    
+    if (meshVAO == 0) {
+        glGenVertexArrays(1, &meshVAO);
+        glGenBuffers(1, &meshVBO);
+        glGenBuffers(1, &meshEBO);
     }
     
-    glGenVertexArrays(1, &meshVAO);
-    glGenBuffers(1, &meshVBO);
-    glGenBuffers(1, &meshEBO);
-    
     glBindVertexArray(meshVAO);
     
-    glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    GLsizei stride = compressedVertexShorts(false) * sizeof(uint16_t);
+    updateBuffer(GL_ARRAY_BUFFER, meshVBO, meshVertexBytes, vertices, vertexCount * stride);
+    updateBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO, meshIndexBytes, indices, indexCount * indexBytes);
+    meshIndexType = (indexBytes == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    glPrimitiveRestartIndex(stripRestartIndex(meshIndexType == GL_UNSIGNED_SHORT));
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-    
-    meshIndexCount = indices.size();
-    
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    // Position attribute (unorm16, decoded with meshBounds)
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)COMPRESSED_POSITION_OFFSET);
     glEnableVertexAttribArray(0);
     
-    // Normal attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    // Normal attribute (octahedral snorm16)
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)COMPRESSED_NORMAL_OFFSET);
     glEnableVertexAttribArray(1);
     
     glBindVertexArray(0);
 }
 
-// Matrix functions
-void createIdentityMatrix(float* matrix) {
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
-    }
+// Pack meshVertices / meshIndices and upload them
+size_t uploadGeneratedMesh(const char* name, bool report) {
+    size_t indexBytes = packMesh(name, report);
+    const void* indices = meshPackedIndices.empty() ? (const void*)meshIndices.data()
+                                                    : (const void*)meshPackedIndices.data();
+    uploadMesh(meshPackedVertices.data(), meshVertices.size() / 6, indices, meshIndices.size(), indexBytes);
+    return indexBytes;
 }
 
-void createLookAtMatrix(float* matrix, float eyeX, float eyeY, float eyeZ,
-                       float centerX, float centerY, float centerZ,
-                       float upX, float upY, float upZ) {
-    float f[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
-    float len = sqrt(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
-    if (len > 1e-6f) {
-        f[0] /= len; f[1] /= len; f[2] /= len;
-    }
-    
-    float s[3] = {
-        f[1] * upZ - f[2] * upY,
-        f[2] * upX - f[0] * upZ,
-        f[0] * upY - f[1] * upX
-    };
-    len = sqrt(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
-    if (len > 1e-6f) {
-        s[0] /= len; s[1] /= len; s[2] /= len;
-    }
-    
-    float u[3] = {
-        s[1] * f[2] - s[2] * f[1],
-        s[2] * f[0] - s[0] * f[2],
-        s[0] * f[1] - s[1] * f[0]
-    };
-    
-    createIdentityMatrix(matrix);
-    matrix[0] = s[0]; matrix[4] = s[1]; matrix[8] = s[2];
-    matrix[1] = u[0]; matrix[5] = u[1]; matrix[9] = u[2];
-    matrix[2] = -f[0]; matrix[6] = -f[1]; matrix[10] = -f[2];
-    matrix[12] = -(s[0]*eyeX + s[1]*eyeY + s[2]*eyeZ);
-    matrix[13] = -(u[0]*eyeX + u[1]*eyeY + u[2]*eyeZ);
-    matrix[14] = f[0]*eyeX + f[1]*eyeY + f[2]*eyeZ;
+// Regenerate meshParams into the reused arrays and buffers, reporting the
+// generation time
+void generateMesh() {
+    auto start = std::chrono::high_resolution_clock::now();
+    generateParametricLods(meshParams, meshThreads, meshLods, meshVertices, meshIndices);
+    auto end = std::chrono::high_resolution_clock::now();
+    
+    uploadGeneratedMesh(parametricShapeName(meshParams.shape), false);
+    std::cout << "Shape: " << parametricShapeName(meshParams.shape) << " " << meshParams.columns << "x"
+              << meshParams.rows << " (" << meshLods[0].triangleCount << " triangles, " << meshLods.size()
+              << " levels generated in " << std::chrono::duration<double, std::milli>(end - start).count()
+              << " ms)" << std::endl;
+}
+
+// Key for the startup mesh cache: every field of meshParams and the LOD
+// chain settings
+uint64_t meshCacheKey() {
+    uint64_t key = meshCacheHashValue(MESH_CACHE_HASH_SEED, (int)meshParams.shape);
+    key = meshCacheHashValue(key, meshParams.columns);
+    key = meshCacheHashValue(key, meshParams.rows);
+    key = meshCacheHashValue(key, meshParams.radius);
+    key = meshCacheHashValue(key, meshParams.minorRadius);
+    key = meshCacheHashValue(key, meshParams.height);
+    key = meshCacheHashValue(key, meshParams.exponentRows);
+    key = meshCacheHashValue(key, meshParams.exponentColumns);
+    key = meshCacheHashValue(key, MAX_LOD_LEVELS);
+    key = meshCacheHashValue(key, MIN_LOD_SEGMENTS);
+    return key;
 }
 
-void createPerspectiveMatrix(float* matrix, float fovy, float aspect, float near, float far) {
-    float f = 1.0f / tan(fovy * M_PI / 360.0f);
+// Startup mesh: upload the cached LOD chain for meshParams straight from
+// the mapping if there is one. Otherwise generate it, upload it and write
+// the packed blobs to the cache for the next launch. The chain layout
+// follows from meshParams, so the file holds only the concatenated levels.
+void loadMesh() {
+    const char* name = parametricShapeName(meshParams.shape);
+    size_t vertexBytes = compressedVertexShorts(false) * sizeof(uint16_t);
+    uint64_t key = meshCacheKey();
+    std::string path;
+    if (meshCacheEnabled) {
+        path = meshCachePath(meshCacheDir, name, key);
+        buildLodChain(1, meshParams.columns, meshParams.rows, meshLods);
+        MappedMesh cached;
+        if (mapMeshCache(path, key, vertexBytes, cached) && cached.vertexCount == lodChainVertexCount(meshLods) &&
+            cached.indexCount == lodChainIndexCount(meshLods)) {
+            meshBounds = cached.bounds;
+            uploadMesh(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount,
+                       cached.layout.indexBytes);
+            std::cout << "Loaded mesh from cache: " << path << std::endl;
+            printLodChain(name, meshLods);
+            unmapMeshCache(cached);
+            return;
+        }
+        unmapMeshCache(cached);
+    }
     
-    createIdentityMatrix(matrix);
-    matrix[0] = f / aspect;
-    matrix[5] = f;
-    matrix[10] = (far + near) / (near - far);
-    matrix[11] = -1.0f;
-    matrix[14] = (2.0f * far * near) / (near - far);
-    matrix[15] = 0.0f;
+    generateParametricLods(meshParams, meshThreads, meshLods, meshVertices, meshIndices);
+    printStripStats(name, meshIndices.data(), meshLods[0].indexCount, meshLods[0].vertexCount);
+    printLodChain(name, meshLods);
+    size_t indexBytes = uploadGeneratedMesh(name, true);
+    if (meshCacheEnabled) {
+        const MeshLayout layout = {(uint16_t)vertexBytes, (uint16_t)indexBytes};
+        const void* indices = meshPackedIndices.empty() ? (const void*)meshIndices.data()
+                                                        : (const void*)meshPackedIndices.data();
+        writeMeshCache(path, key, layout, meshBounds, meshPackedVertices.data(), meshVertices.size() / 6,
+                       indices, meshIndices.size());
+    }
 }
 
 void keyboard(unsigned char key, int x, int y) {
@@ -363,6 +362,48 @@ void keyboard(unsigned char key, int x, int y) {
             cameraAngleY = 45.0f;
             cameraDistance = 5.0f;
             break;
+        
+        // Shape and tessellation
+        case 'm':
+        case 'M': {
+            int step = (key == 'm') ? 1 : SHAPE_COUNT - 1;
+            ParametricShape shape = (ParametricShape)((meshParams.shape + step) % SHAPE_COUNT);
+            meshParams = defaultParametricParams(shape);
+            generateMesh();
+            break;
+        }
+        case '+':
+        case '=':
+            if (std::max(meshParams.columns, meshParams.rows) * 2 <= MAX_MESH_SEGMENTS) {
+                meshParams.columns *= 2;
+                meshParams.rows *= 2;
+                generateMesh();
+            }
+            break;
+        case '-':
+        case '_':
+            if (std::min(meshParams.columns, meshParams.rows) / 2 >= 4) {
+                meshParams.columns /= 2;
+                meshParams.rows /= 2;
+                generateMesh();
+            }
+            break;
+        case 'e':
+        case 'E': {
+            float scale = (key == 'e') ? 0.8f : 1.25f;
+            meshParams.exponentRows = std::max(0.1f, std::min(4.0f, meshParams.exponentRows * scale));
+            meshParams.exponentColumns = std::max(0.1f, std::min(4.0f, meshParams.exponentColumns * scale));
+            if (meshParams.shape == SHAPE_SUPERQUADRIC) {
+                generateMesh();
+            }
+            std::cout << "Superquadric exponent: " << meshParams.exponentRows << std::endl;
+            break;
+        }
+        case 'l':
+        case 'L':
+            lodEnabled = !lodEnabled;
+            std::cout << "Level of detail: " << (lodEnabled ? "by distance" : "always full") << std::endl;
+            break;
         case 27:
             exit(0);
             break;
@@ -385,6 +426,12 @@ void specialKeys(int key, int x, int y) {
         case GLUT_KEY_RIGHT:
             cameraAngleY += delta;
             break;
+        case GLUT_KEY_PAGE_UP:
+            cameraDistance = std::max(2.0f, cameraDistance * 0.8f);
+            break;
+        case GLUT_KEY_PAGE_DOWN:
+            cameraDistance = std::min(80.0f, cameraDistance * 1.25f);
+            break;
     }
     glutPostRedisplay();
 }
@@ -396,33 +443,64 @@ void display() {
     float camY = cameraDistance * sin(cameraAngleX * M_PI / 180.0f);
     float camZ = cameraDistance * sin(cameraAngleY * M_PI / 180.0f) * cos(cameraAngleX * M_PI / 180.0f);
     
-    float model[16], view[16], projection[16];
-    createIdentityMatrix(model);
-    createLookAtMatrix(view, camX, camY, camZ, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-    createPerspectiveMatrix(projection, 45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
-    
-    glUseProgram(shaderProgram);
-    
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightPos"), lightPos[0], lightPos[1], lightPos[2]);
-    glUniform3f(glGetUniformLocation(shaderProgram, "viewPos"), camX, camY, camZ);
-    glUniform3f(glGetUniformLocation(shaderProgram, "lightColor"), 1.0f, 1.0f, 1.0f);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ka"), ka);
-    glUniform1f(glGetUniformLocation(shaderProgram, "kd"), kd);
-    glUniform1f(glGetUniformLocation(shaderProgram, "ks"), ks);
-    glUniform1f(glGetUniformLocation(shaderProgram, "shininess"), shininess);
-    
+    Mat4 view = Mat4::lookAt(Vec3{camX, camY, camZ}, Vec3{0.0f, 0.0f, 0.0f}, Vec3{0.0f, 1.0f, 0.0f});
+    Mat4 projection = Mat4::perspective(45.0f, 800.0f / 600.0f, 0.1f, 100.0f);
+    
+    FrameUniforms frame;
+    float viewPos[3] = {camX, camY, camZ};
+    float lightColor[3] = {1.0f, 1.0f, 1.0f};
+    setFrameUniforms(frame, view.m, projection.m, lightPos, viewPos, lightColor);
+    frameUniforms.update(frame);
+    
+    shaderProgram.use();
+    
+    shaderProgram.setFloat(phong.ka, ka);
+    shaderProgram.setFloat(phong.kd, kd);
+    shaderProgram.setFloat(phong.ks, ks);
+    shaderProgram.setFloat(phong.shininess, shininess);
+    shaderProgram.setVec3(phong.positionMin, meshBounds.min[0], meshBounds.min[1], meshBounds.min[2]);
+    shaderProgram.setVec3(phong.positionScale, meshBounds.scale[0], meshBounds.scale[1], meshBounds.scale[2]);
+    
+    // Instances on a square grid in the xz plane, centred on the origin;
+    // each picks its level from its projected size
+    size_t indexSize = (meshIndexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(unsigned int);
+    int side = (int)std::ceil(std::sqrt((float)meshInstances));
+    float spacing = 2.5f * meshRadius;
+    std::vector<size_t> counts(meshLods.size(), 0);
+    size_t triangles = 0;
     glBindVertexArray(meshVAO);
-    glDrawElements(GL_TRIANGLES, meshIndexCount, GL_UNSIGNED_INT, 0);
+    for (int i = 0; i < meshInstances; i++) {
+        float x = ((i % side) - (side - 1) * 0.5f) * spacing;
+        float z = ((i / side) - (side - 1) * 0.5f) * spacing;
+        float dx = camX - x, dz = camZ - z;
+        float distance = std::sqrt(dx * dx + camY * camY + dz * dz);
+        int level = lodEnabled ? selectLod(meshLods, meshRadius, distance, 45.0f, windowHeight) : 0;
+        const MeshLod& lod = meshLods[level];
+        counts[level]++;
+        triangles += lod.triangleCount;
+        
+        Mat4 model = Mat4::translation(x, 0.0f, z);
+        shaderProgram.setMat4(phong.model, model.m);
+        glDrawElementsBaseVertex(GL_TRIANGLE_STRIP, (GLsizei)lod.indexCount, meshIndexType,
+                                 (void*)(lod.firstIndex * indexSize), (GLint)lod.firstVertex);
+    }
     glBindVertexArray(0);
     
+    if (counts != lodInstanceCounts) {
+        lodInstanceCounts = counts;
+        std::cout << "Instances per level:";
+        for (size_t l = 0; l < counts.size(); l++) {
+            std::cout << " " << counts[l];
+        }
+        std::cout << " (" << triangles << " triangles)" << std::endl;
+    }
+    
     glutSwapBuffers();
 }
 
 void reshape(int width, int height) {
     glViewport(0, 0, width, height);
+    windowHeight = std::max(1, height);
 }
 
 unsigned int compileShader(unsigned int type, const char* source) {
@@ -449,30 +527,65 @@ void init() {
     }
     
     glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PRIMITIVE_RESTART);  // Meshes are strips; uploadMesh sets the restart index
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     
     unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
     unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
     
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    
+    shaderProgram.link(vertexShader, fragmentShader);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
     
-    // Create a torus mesh (can be replaced with SMF loader)
-    createTorusMesh(1.5f, 0.5f, 32, 16);
-    // Alternative: createSphereMesh(1.5f, 32);
+    phong.model = shaderProgram.location("model");
+    phong.ka = shaderProgram.location("ka");
+    phong.kd = shaderProgram.location("kd");
+    phong.ks = shaderProgram.location("ks");
+    phong.shininess = shaderProgram.location("shininess");
+    phong.positionMin = shaderProgram.location("positionMin");
+    phong.positionScale = shaderProgram.location("positionScale");
+    frameUniforms.create();
+    
+    // Parametric mesh (torus unless --shape says otherwise)
+    loadMesh();
     
     std::cout << "Assignment 4 Part 3b - 3D Procedural Texturing" << std::endl;
     std::cout << "Arrow keys: Rotate camera" << std::endl;
+    std::cout << "Page Up/Down: Zoom in/out" << std::endl;
     std::cout << "R/r: Reset view" << std::endl;
+    std::cout << "m/M: Next/previous shape (torus, sphere, cylinder, cone, superquadric)" << std::endl;
+    std::cout << "+/-: Double/halve segments" << std::endl;
+    std::cout << "e/E: Squarer/rounder superquadric" << std::endl;
+    std::cout << "L/l: Toggle distance-based level of detail" << std::endl;
     std::cout << "ESC: Exit" << std::endl;
 }
 
 int main(int argc, char** argv) {
+    int segments = 0;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--no-mesh-cache") {
+            meshCacheEnabled = false;
+        } else if (arg == "--shape" && a + 1 < argc) {
+            std::string name = argv[++a];
+            for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+                if (name == parametricShapeName((ParametricShape)shape)) {
+                    meshParams = defaultParametricParams((ParametricShape)shape);
+                }
+            }
+        } else if (arg == "--segments" && a + 1 < argc) {
+            segments = std::max(4, std::min(MAX_MESH_SEGMENTS, atoi(argv[++a])));
+        } else if (arg == "--threads" && a + 1 < argc) {
+            meshThreads = std::max(1, atoi(argv[++a]));
+        } else if (arg == "--instances" && a + 1 < argc) {
+            meshInstances = std::max(1, atoi(argv[++a]));
+        }
+    }
+    if (segments > 0) {
+        meshParams.columns = segments;
+        meshParams.rows = segments;
+    }
+    
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
     glutInitWindowSize(800, 600);
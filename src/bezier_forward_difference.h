@@ -0,0 +1,214 @@
+// Forward-differencing tessellation of a single bicubic Bezier patch, shared
+// by the Bezier programs (CPU only, no OpenGL calls). The patch is passed as
+// 16 xyz control points in the programs' controlPoints order (i along u,
+// j along v).
+#ifndef BEZIER_FORWARD_DIFFERENCE_H
+#define BEZIER_FORWARD_DIFFERENCE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include "bezier_surface.h"
+
+// Cubic polynomial f(t) = a t^3 + b t^2 + c t + d (per coordinate) walked by
+// forward differencing: each step is three additions per coordinate
+struct CubicDifferencer {
+    float a[3], b[3], c[3], d[3];  // Power-basis coefficients
+    float h;                       // Parameter step
+    float f[3], d1[3], d2[3], d3[3];  // Value and forward differences
+};
+
+// Power-basis coefficients of the cubic Bezier curve with control points p[0..3]
+inline void setCubicFromBezier(CubicDifferencer& fd, const float p[4][3], float h) {
+    for (int k = 0; k < 3; k++) {
+        fd.a[k] = -p[0][k] + 3.0f * p[1][k] - 3.0f * p[2][k] + p[3][k];
+        fd.b[k] = 3.0f * p[0][k] - 6.0f * p[1][k] + 3.0f * p[2][k];
+        fd.c[k] = -3.0f * p[0][k] + 3.0f * p[1][k];
+        fd.d[k] = p[0][k];
+    }
+    fd.h = h;
+}
+
+// Derivative of src (a quadratic, stored as a cubic with a = 0)
+inline void setCubicDerivative(CubicDifferencer& fd, const CubicDifferencer& src) {
+    for (int k = 0; k < 3; k++) {
+        fd.a[k] = 0.0f;
+        fd.b[k] = 3.0f * src.a[k];
+        fd.c[k] = 2.0f * src.b[k];
+        fd.d[k] = src.c[k];
+    }
+    fd.h = src.h;
+}
+
+// Reset value and differences from the exact polynomial at parameter t
+inline void seedCubic(CubicDifferencer& fd, float t) {
+    float h = fd.h;
+    float h2 = h * h;
+    float h3 = h2 * h;
+    for (int k = 0; k < 3; k++) {
+        float a = fd.a[k], b = fd.b[k], c = fd.c[k];
+        fd.f[k] = ((a * t + b) * t + c) * t + fd.d[k];
+        fd.d1[k] = a * (3.0f * t * t * h + 3.0f * t * h2 + h3) + b * (2.0f * t * h + h2) + c * h;
+        fd.d2[k] = a * (6.0f * t * h2 + 6.0f * h3) + 2.0f * b * h2;
+        fd.d3[k] = 6.0f * a * h3;
+    }
+}
+
+// Advance one step (additions only)
+inline void stepCubic(CubicDifferencer& fd) {
+    for (int k = 0; k < 3; k++) {
+        fd.f[k] += fd.d1[k];
+        fd.d1[k] += fd.d2[k];
+        fd.d2[k] += fd.d3[k];
+    }
+}
+
+// Normalized du x dv
+inline void crossNormalize(const float* du, const float* dv, float* normal) {
+    normal[0] = du[1] * dv[2] - du[2] * dv[1];
+    normal[1] = du[2] * dv[0] - du[0] * dv[2];
+    normal[2] = du[0] * dv[1] - du[1] * dv[0];
+
+    float len = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    if (len > 1e-6f) {
+        normal[0] /= len;
+        normal[1] /= len;
+        normal[2] /= len;
+    }
+}
+
+// Collapse the patch to the u-direction cubic at fixed v: rowPoints[i] = sum_j P[i][j] B_j(v),
+// rowTangents[i] = sum_j P[i][j] B'_j(v)
+inline void computeRowCurves(const float* controlPoints, float v, float rowPoints[4][3], float rowTangents[4][3]) {
+    float s = 1.0f - v;
+    float bv[4] = {s * s * s, 3.0f * s * s * v, 3.0f * s * v * v, v * v * v};
+    float dbv[4] = {-3.0f * s * s, 3.0f * (s * s - 2.0f * s * v), 3.0f * (2.0f * s * v - v * v), 3.0f * v * v};
+
+    for (int i = 0; i < 4; i++) {
+        for (int k = 0; k < 3; k++) {
+            rowPoints[i][k] = 0.0f;
+            rowTangents[i][k] = 0.0f;
+            for (int j = 0; j < 4; j++) {
+                float p = controlPoints[(i * 4 + j) * 3 + k];
+                rowPoints[i][k] += p * bv[j];
+                rowTangents[i][k] += p * dbv[j];
+            }
+        }
+    }
+}
+
+// Forward-differencing tessellation of grid rows [rowBegin, rowEnd) of the
+// (res+1)^2 vertex grid: each row is a cubic in u walked with additions only,
+// re-seeded every reseedInterval steps (0 = never) to bound float drift.
+// Vertices are position + normal, plus u, v with texCoords.
+inline void tessellatePatchForwardDifferenceRows(const float* controlPoints, int res, int reseedInterval,
+                                                 bool texCoords, int rowBegin, int rowEnd, float* vertices) {
+    int stride = surfaceVertexStride(texCoords);
+    float* out = vertices + (size_t)rowBegin * (res + 1) * stride;
+    float h = 1.0f / res;
+
+    for (int j = rowBegin; j < rowEnd; j++) {
+        float v = (float)j / res;
+        float rowPoints[4][3], rowTangents[4][3];
+        computeRowCurves(controlPoints, v, rowPoints, rowTangents);
+
+        CubicDifferencer pos, du, dv;
+        setCubicFromBezier(pos, rowPoints, h);
+        setCubicDerivative(du, pos);
+        setCubicFromBezier(dv, rowTangents, h);
+        seedCubic(pos, 0.0f);
+        seedCubic(du, 0.0f);
+        seedCubic(dv, 0.0f);
+
+        for (int i = 0; i <= res; i++) {
+            float u = (float)i / res;
+            if (i > 0) {
+                if (reseedInterval > 0 && i % reseedInterval == 0) {
+                    seedCubic(pos, u);
+                    seedCubic(du, u);
+                    seedCubic(dv, u);
+                } else {
+                    stepCubic(pos);
+                    stepCubic(du);
+                    stepCubic(dv);
+                }
+            }
+
+            out[0] = pos.f[0];
+            out[1] = pos.f[1];
+            out[2] = pos.f[2];
+            crossNormalize(du.f, dv.f, out + 3);
+            if (texCoords) {
+                out[6] = u;
+                out[7] = v;
+            }
+            out += stride;
+        }
+    }
+}
+
+inline void tessellatePatchForwardDifference(const float* controlPoints, int res, int reseedInterval,
+                                             bool texCoords, std::vector<float>& vertices) {
+    vertices.resize((size_t)(res + 1) * (res + 1) * surfaceVertexStride(texCoords));
+    tessellatePatchForwardDifferenceRows(controlPoints, res, reseedInterval, texCoords, 0, res + 1, vertices.data());
+}
+
+// Milliseconds per call of fn, averaged over iterations
+template <typename Fn>
+double timeMilliseconds(int iterations, Fn fn) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int n = 0; n < iterations; n++) {
+        fn();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+}
+
+// Largest absolute difference between matching floats of two vertex arrays,
+// split into position and normal parts (stride floats per vertex)
+inline void maxDeviation(const std::vector<float>& a, const std::vector<float>& b, int stride,
+                         float& maxPosition, float& maxNormal) {
+    maxPosition = 0.0f;
+    maxNormal = 0.0f;
+    for (size_t n = 0; n + stride <= a.size() && n + stride <= b.size(); n += stride) {
+        for (int k = 0; k < 3; k++) {
+            maxPosition = std::max(maxPosition, (float)fabs(a[n + k] - b[n + k]));
+            maxNormal = std::max(maxNormal, (float)fabs(a[n + 3 + k] - b[n + 3 + k]));
+        }
+    }
+}
+
+// Forward differencing accuracy and speed against a program's own evaluator:
+// reference(res, vertices) must tessellate the same control points with the
+// same vertex layout
+template <typename Reference>
+void benchmarkForwardDifference(const float* controlPoints, bool texCoords, const int* resolutions, int resolutionCount,
+                                const char* referenceName, Reference reference) {
+    std::cout << "\n=== Forward differencing: max deviation vs " << referenceName << " evaluator ===" << std::endl;
+
+    int reseedIntervals[] = {0, 64, 16};
+    for (int r = 0; r < resolutionCount; r++) {
+        int res = resolutions[r];
+        std::vector<float> expected, differenced;
+        int iterations = res <= 64 ? 50 : 3;
+        double referenceMs = timeMilliseconds(iterations, [&]() { reference(res, expected); });
+
+        for (int interval : reseedIntervals) {
+            double fdMs = timeMilliseconds(iterations, [&]() {
+                tessellatePatchForwardDifference(controlPoints, res, interval, texCoords, differenced);
+            });
+            float maxPosition, maxNormal;
+            maxDeviation(expected, differenced, surfaceVertexStride(texCoords), maxPosition, maxNormal);
+
+            std::cout << "  " << res << "x" << res << ", re-seed "
+                      << (interval == 0 ? std::string("never") : "every " + std::to_string(interval))
+                      << ": position " << maxPosition << ", normal " << maxNormal
+                      << ", " << fdMs << " ms (" << referenceName << " " << referenceMs << " ms)" << std::endl;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,306 @@
+// Multi-patch bicubic Bezier surfaces: file loader and parallel tessellator
+// shared by the Bezier programs (CPU only, no OpenGL calls).
+#ifndef BEZIER_SURFACE_H
+#define BEZIER_SURFACE_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "thread_pool.h"
+
+// Patches stored as structure-of-arrays. Control point k of patch p is
+// (x[p * 16 + k], y[p * 16 + k], z[p * 16 + k]), with k = i * 4 + j in the
+// same order as the programs' controlPoints vector (i along u, j along v).
+struct BezierSurface {
+    std::vector<float> x, y, z;
+
+    int patchCount() const {
+        return (int)(x.size() / 16);
+    }
+
+    void clear() {
+        x.clear();
+        y.clear();
+        z.clear();
+    }
+
+    // points: 16 xyz triples
+    void addPatch(const float* points) {
+        for (int k = 0; k < 16; k++) {
+            x.push_back(points[k * 3 + 0]);
+            y.push_back(points[k * 3 + 1]);
+            z.push_back(points[k * 3 + 2]);
+        }
+    }
+
+    void getPatch(int p, float* points) const {
+        for (int k = 0; k < 16; k++) {
+            points[k * 3 + 0] = x[p * 16 + k];
+            points[k * 3 + 1] = y[p * 16 + k];
+            points[k * 3 + 2] = z[p * 16 + k];
+        }
+    }
+
+    void setPatch(int p, const float* points) {
+        for (int k = 0; k < 16; k++) {
+            x[p * 16 + k] = points[k * 3 + 0];
+            y[p * 16 + k] = points[k * 3 + 1];
+            z[p * 16 + k] = points[k * 3 + 2];
+        }
+    }
+};
+
+// Split a line into numbers; commas count as whitespace
+inline std::vector<float> parseNumbers(std::string line) {
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream stream(line);
+    std::vector<float> numbers;
+    float value;
+    while (stream >> value) {
+        numbers.push_back(value);
+    }
+    return numbers;
+}
+
+// Load patches from a text file in one of three layouts:
+//  - plain:  "x y z" per line, 16 lines per patch (src/control_points.txt)
+//  - BPT:    patch count, then per patch a "3 3" degree line and 16 "x y z" lines
+//  - Newell: patch count, one line of 16 one-based vertex indices per patch,
+//            vertex count, then "x, y, z" per vertex (Utah teapot data)
+// Returns false and prints the reason if the file cannot be used.
+inline bool loadBezierSurface(const char* path, BezierSurface& surface) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open control point file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::vector<float> > lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::vector<float> numbers = parseNumbers(line);
+        if (!numbers.empty()) {
+            lines.push_back(numbers);
+        }
+    }
+
+    surface.clear();
+    if (lines.empty()) {
+        std::cerr << "No control points in " << path << std::endl;
+        return false;
+    }
+
+    size_t next = 0;
+    float patch[48];
+    if (lines[0].size() == 3) {
+        // Plain list of points
+        if (lines.size() % 16 != 0) {
+            std::cerr << path << ": " << lines.size() << " points is not a multiple of 16" << std::endl;
+            return false;
+        }
+        for (; next < lines.size(); next++) {
+            int k = next % 16;
+            patch[k * 3 + 0] = lines[next][0];
+            patch[k * 3 + 1] = lines[next][1];
+            patch[k * 3 + 2] = lines[next][2];
+            if (k == 15) {
+                surface.addPatch(patch);
+            }
+        }
+    } else if (lines[0].size() == 1 && lines.size() > 1 && lines[1].size() == 2) {
+        // BPT: degree line followed by (degree + 1)^2 points per patch
+        int count = (int)lines[0][0];
+        next = 1;
+        for (int p = 0; p < count; p++) {
+            if (next + 17 > lines.size() || lines[next][0] != 3 || lines[next][1] != 3) {
+                std::cerr << path << ": patch " << p << " is truncated or not bicubic" << std::endl;
+                return false;
+            }
+            next++;
+            for (int k = 0; k < 16; k++, next++) {
+                if (lines[next].size() < 3) {
+                    std::cerr << path << ": bad point in patch " << p << std::endl;
+                    return false;
+                }
+                patch[k * 3 + 0] = lines[next][0];
+                patch[k * 3 + 1] = lines[next][1];
+                patch[k * 3 + 2] = lines[next][2];
+            }
+            surface.addPatch(patch);
+        }
+    } else if (lines[0].size() == 1 && lines.size() > 1 && lines[1].size() == 16) {
+        // Newell: indexed patches followed by a shared vertex list
+        int count = (int)lines[0][0];
+        size_t verticesLine = 1 + count;
+        if (verticesLine >= lines.size() || lines[verticesLine].size() != 1) {
+            std::cerr << path << ": missing vertex count after " << count << " patches" << std::endl;
+            return false;
+        }
+        int vertexCount = (int)lines[verticesLine][0];
+        if (verticesLine + 1 + vertexCount > lines.size()) {
+            std::cerr << path << ": expected " << vertexCount << " vertices" << std::endl;
+            return false;
+        }
+        for (int p = 0; p < count; p++) {
+            const std::vector<float>& ids = lines[1 + p];
+            if (ids.size() != 16) {
+                std::cerr << path << ": patch " << p << " needs 16 vertex indices" << std::endl;
+                return false;
+            }
+            for (int k = 0; k < 16; k++) {
+                int id = (int)ids[k];
+                if (id < 1 || id > vertexCount || lines[verticesLine + id].size() < 3) {
+                    std::cerr << path << ": bad vertex index in patch " << p << std::endl;
+                    return false;
+                }
+                const std::vector<float>& point = lines[verticesLine + id];
+                patch[k * 3 + 0] = point[0];
+                patch[k * 3 + 1] = point[1];
+                patch[k * 3 + 2] = point[2];
+            }
+            surface.addPatch(patch);
+        }
+    } else {
+        std::cerr << path << ": unrecognized control point format" << std::endl;
+        return false;
+    }
+
+    return surface.patchCount() > 0;
+}
+
+// Floats per vertex: position + normal, plus u, v with texture coordinates
+inline int surfaceVertexStride(bool texCoords) {
+    return texCoords ? 8 : 6;
+}
+
+// Tessellate one patch into its (res+1)^2 vertex block. Each row first
+// collapses the 4x4 net to the u-direction curve at that v (and its v
+// derivative), so every vertex needs only 4 terms per sum.
+inline void tessellateSurfacePatch(const BezierSurface& surface, int patch, int res, bool texCoords, float* vertices) {
+    const float* px = &surface.x[patch * 16];
+    const float* py = &surface.y[patch * 16];
+    const float* pz = &surface.z[patch * 16];
+    int stride = surfaceVertexStride(texCoords);
+    float* out = vertices;
+
+    for (int j = 0; j <= res; j++) {
+        float v = (float)j / res;
+        float s = 1.0f - v;
+        float bv[4] = {s * s * s, 3.0f * s * s * v, 3.0f * s * v * v, v * v * v};
+        float dbv[4] = {-3.0f * s * s, 3.0f * (s * s - 2.0f * s * v), 3.0f * (2.0f * s * v - v * v), 3.0f * v * v};
+
+        // Row curve control points (q) and their v derivatives (r)
+        float q[4][3], r[4][3];
+        for (int i = 0; i < 4; i++) {
+            q[i][0] = q[i][1] = q[i][2] = 0.0f;
+            r[i][0] = r[i][1] = r[i][2] = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                int c = i * 4 + k;
+                q[i][0] += px[c] * bv[k];
+                q[i][1] += py[c] * bv[k];
+                q[i][2] += pz[c] * bv[k];
+                r[i][0] += px[c] * dbv[k];
+                r[i][1] += py[c] * dbv[k];
+                r[i][2] += pz[c] * dbv[k];
+            }
+        }
+
+        for (int i = 0; i <= res; i++) {
+            float u = (float)i / res;
+            float t = 1.0f - u;
+            float bu[4] = {t * t * t, 3.0f * t * t * u, 3.0f * t * u * u, u * u * u};
+            float dbu[4] = {-3.0f * t * t, 3.0f * (t * t - 2.0f * t * u), 3.0f * (2.0f * t * u - u * u), 3.0f * u * u};
+
+            float pos[3] = {0.0f, 0.0f, 0.0f};
+            float du[3] = {0.0f, 0.0f, 0.0f};
+            float dv[3] = {0.0f, 0.0f, 0.0f};
+            for (int k = 0; k < 4; k++) {
+                for (int c = 0; c < 3; c++) {
+                    pos[c] += q[k][c] * bu[k];
+                    du[c] += q[k][c] * dbu[k];
+                    dv[c] += r[k][c] * bu[k];
+                }
+            }
+
+            float nx = du[1] * dv[2] - du[2] * dv[1];
+            float ny = du[2] * dv[0] - du[0] * dv[2];
+            float nz = du[0] * dv[1] - du[1] * dv[0];
+            float len = sqrt(nx * nx + ny * ny + nz * nz);
+            if (len > 1e-6f) {
+                nx /= len;
+                ny /= len;
+                nz /= len;
+            }
+
+            out[0] = pos[0];
+            out[1] = pos[1];
+            out[2] = pos[2];
+            out[3] = nx;
+            out[4] = ny;
+            out[5] = nz;
+            if (texCoords) {
+                out[6] = u;
+                out[7] = v;
+            }
+            out += stride;
+        }
+    }
+}
+
+// Indices for patch `patch`, whose vertices start at patch * (res+1)^2
+inline void generateSurfacePatchIndices(int patch, int res, unsigned int* indices) {
+    unsigned int base = (unsigned int)patch * (res + 1) * (res + 1);
+    for (int j = 0; j < res; j++) {
+        for (int i = 0; i < res; i++) {
+            unsigned int topLeft = base + j * (res + 1) + i;
+            unsigned int topRight = topLeft + 1;
+            unsigned int bottomLeft = base + (j + 1) * (res + 1) + i;
+            unsigned int bottomRight = bottomLeft + 1;
+
+            indices[0] = topLeft;
+            indices[1] = bottomLeft;
+            indices[2] = topRight;
+            indices[3] = topRight;
+            indices[4] = bottomLeft;
+            indices[5] = bottomRight;
+            indices += 6;
+        }
+    }
+}
+
+// Tessellate every patch into one shared vertex/index buffer so the whole
+// surface renders with a single draw call. Patches are split into contiguous
+// ranges across `threads` threads of the shared pool (thread_pool.h);
+// outputs are sized up front and each thread writes only its own patches'
+// blocks.
+inline void tessellateBezierSurface(const BezierSurface& surface, int res, bool texCoords, int threads,
+                                    std::vector<float>& vertices, std::vector<unsigned int>& indices,
+                                    bool buildIndices = true) {
+    int patches = surface.patchCount();
+    size_t patchVertexFloats = (size_t)(res + 1) * (res + 1) * surfaceVertexStride(texCoords);
+    size_t patchIndexCount = (size_t)res * res * 6;
+    vertices.resize(patches * patchVertexFloats);
+    if (buildIndices) {
+        indices.resize(patches * patchIndexCount);
+    }
+
+    const BezierSurface* source = &surface;
+    float* vertexData = vertices.data();
+    unsigned int* indexData = indices.data();
+    auto work = [=](int begin, int end) {
+        for (int p = begin; p < end; p++) {
+            tessellateSurfacePatch(*source, p, res, texCoords, vertexData + p * patchVertexFloats);
+            if (buildIndices) {
+                generateSurfacePatchIndices(p, res, indexData + p * patchIndexCount);
+            }
+        }
+    };
+
+    parallelRanges(patches, threads, work);
+}
+
+#endif
@@ -0,0 +1,153 @@
+// OpenGL 4.0 tessellation shaders for bicubic Bezier patches, shared by the
+// Bezier programs. Control points are drawn as 16-vertex GL_PATCHES (k = i * 4
+// + j, i along u); the control shader picks levels from the projected length
+// of each boundary, the evaluation shader computes position, normal and the
+// patch (u, v) as TexCoord. Pair them with the program's Phong fragment
+// shader (TexCoord is ignored when it does not declare it).
+//
+// Uniforms: model, viewportSize (pixels), pixelsPerSegment, maxTessLevel, and
+// the FrameData block from shader_program.h.
+#ifndef BEZIER_TESS_SHADERS_H
+#define BEZIER_TESS_SHADERS_H
+
+const char* const bezierTessVertexShaderSource = R"(
+#version 400 core
+layout (location = 0) in vec3 aPos;
+
+out vec3 ControlPoint;
+
+void main()
+{
+    ControlPoint = aPos;
+}
+)";
+
+const char* const bezierTessControlShaderSource = R"(
+#version 400 core
+layout (vertices = 16) out;
+
+in vec3 ControlPoint[];
+out vec3 PatchPoint[];
+
+uniform mat4 model;
+uniform vec2 viewportSize;
+uniform float pixelsPerSegment;
+uniform float maxTessLevel;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
+// Control point k in window pixels
+vec2 toScreen(int k)
+{
+    vec4 clip = projection * view * model * vec4(ControlPoint[k], 1.0);
+    return (clip.xy / max(clip.w, 1e-4) * 0.5 + 0.5) * viewportSize;
+}
+
+// Level for a boundary curve from the pixel length of its control polygon.
+// The sum is symmetric in the point order, so two patches sharing an edge
+// pick the same level and the surface stays crack-free.
+float edgeLevel(int a, int b, int c, int d)
+{
+    vec2 p0 = toScreen(a);
+    vec2 p1 = toScreen(b);
+    vec2 p2 = toScreen(c);
+    vec2 p3 = toScreen(d);
+    float pixels = (distance(p0, p1) + distance(p2, p3)) + distance(p1, p2);
+    return clamp(pixels / pixelsPerSegment, 1.0, maxTessLevel);
+}
+
+void main()
+{
+    PatchPoint[gl_InvocationID] = ControlPoint[gl_InvocationID];
+
+    if (gl_InvocationID == 0) {
+        // Point k = i * 4 + j sits at (u, v) = (i / 3, j / 3)
+        float edgeU0 = edgeLevel(0, 1, 2, 3);
+        float edgeV0 = edgeLevel(0, 4, 8, 12);
+        float edgeU1 = edgeLevel(12, 13, 14, 15);
+        float edgeV1 = edgeLevel(3, 7, 11, 15);
+    
+        gl_TessLevelOuter[0] = edgeU0;
+        gl_TessLevelOuter[1] = edgeV0;
+        gl_TessLevelOuter[2] = edgeU1;
+        gl_TessLevelOuter[3] = edgeV1;
+        gl_TessLevelInner[0] = max(edgeV0, edgeV1);
+        gl_TessLevelInner[1] = max(edgeU0, edgeU1);
+    }
+}
+)";
+
+const char* const bezierTessEvaluationShaderSource = R"(
+#version 400 core
+layout (quads, equal_spacing, ccw) in;
+
+in vec3 PatchPoint[];
+
+uniform mat4 model;
+
+// Per-frame camera and light (FrameUniforms in shader_program.h)
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    vec4 lightPos;
+    vec4 viewPos;
+    vec4 lightColor;
+};
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoord;
+out vec3 LightDir;
+out vec3 ViewDir;
+
+// Cubic Bernstein basis and its derivative at t
+void bernstein(float t, out vec4 b, out vec4 db)
+{
+    float s = 1.0 - t;
+    b = vec4(s * s * s, 3.0 * s * s * t, 3.0 * s * t * t, t * t * t);
+    db = vec4(-3.0 * s * s, 3.0 * (s * s - 2.0 * s * t), 3.0 * (2.0 * s * t - t * t), 3.0 * t * t);
+}
+
+void main()
+{
+    vec4 bu, dbu, bv, dbv;
+    bernstein(gl_TessCoord.x, bu, dbu);
+    bernstein(gl_TessCoord.y, bv, dbv);
+
+    vec3 pos = vec3(0.0);
+    vec3 du = vec3(0.0);
+    vec3 dv = vec3(0.0);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            vec3 p = PatchPoint[i * 4 + j];
+            pos += p * (bu[i] * bv[j]);
+            du += p * (dbu[i] * bv[j]);
+            dv += p * (bu[i] * dbv[j]);
+        }
+    }
+
+    // Normal = du x dv, left unnormalized when degenerate (as on the CPU)
+    vec3 normal = cross(du, dv);
+    float len = length(normal);
+    if (len > 1e-6) {
+        normal /= len;
+    }
+
+    FragPos = vec3(model * vec4(pos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * normal;
+    TexCoord = gl_TessCoord.xy;
+    LightDir = normalize(lightPos.xyz - FragPos);
+    ViewDir = normalize(viewPos.xyz - FragPos);
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
+)";
+
+#endif
@@ -0,0 +1,177 @@
+// On-disk cache for generated meshes, stored in the form they are uploaded
+// in. Each file holds one mesh:
+//   MeshCacheHeader | vertex blob (compressed, vertex_compression.h) |
+//   index blob (16- or 32-bit)
+// Files are named by a hash of everything that produced the mesh, and are
+// memory-mapped on load so the blobs go straight to glBufferData.
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "vertex_compression.h"
+
+// 2: vertex cache optimized index order, 3: strips, 4: 64-byte header,
+// 5: compressed vertices, bounds and index width, 6: no 16-bit lists with
+// 65536 vertices
+const uint32_t MESH_CACHE_VERSION = 6;
+const uint64_t MESH_CACHE_HASH_SEED = 14695981039346656037ULL;  // FNV-1a offset basis
+
+// Blob layout: bytes per vertex (compressedVertexShorts() * 2) and per
+// index (2 or 4)
+struct MeshLayout {
+    uint16_t vertexBytes;
+    uint16_t indexBytes;
+};
+
+// 64 bytes, so the vertex blob that follows stays aligned
+struct MeshCacheHeader {
+    char magic[8];        // "MESHBIN\0"
+    uint32_t version;
+    MeshLayout layout;
+    uint64_t key;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    MeshBounds bounds;    // Decode transform of the compressed positions
+};
+
+static_assert(sizeof(MeshCacheHeader) == 64, "MeshCacheHeader must stay 64 bytes");
+
+// FNV-1a over raw bytes; chain calls to hash several inputs into one key
+inline uint64_t meshCacheHash(uint64_t hash, const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t meshCacheHashValue(uint64_t hash, const T& value) {
+    return meshCacheHash(hash, &value, sizeof(T));
+}
+
+// "<dir>/<name>-<key in hex>.mesh"; creates dir if needed
+inline std::string meshCachePath(const char* dir, const char* name, uint64_t key) {
+    mkdir(dir, 0755);
+    char file[64];
+    snprintf(file, sizeof(file), "-%016llx.mesh", (unsigned long long)key);
+    return std::string(dir) + "/" + name + file;
+}
+
+// A mapped cache file. vertices/indices point into the mapping and stay
+// valid until unmapMeshCache.
+struct MappedMesh {
+    void* base;
+    size_t size;
+    const uint16_t* vertices;
+    const void* indices;      // uint16_t or unsigned int, per layout.indexBytes
+    size_t vertexCount;
+    size_t indexCount;
+    MeshLayout layout;
+    MeshBounds bounds;
+};
+
+inline void unmapMeshCache(MappedMesh& mesh) {
+    if (mesh.base) {
+        munmap(mesh.base, mesh.size);
+    }
+    mesh.base = nullptr;
+    mesh.size = 0;
+}
+
+// Map a cache file and check it matches key and vertex size; the index
+// width is whatever the file was written with. A missing file is a silent
+// miss; a stale or truncated one is reported and ignored.
+inline bool mapMeshCache(const std::string& path, uint64_t key, size_t vertexBytes, MappedMesh& mesh) {
+    mesh.base = nullptr;
+    mesh.size = 0;
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MeshCacheHeader)) {
+        close(fd);
+        std::cerr << "Ignoring truncated mesh cache: " << path << std::endl;
+        return false;
+    }
+    size_t size = (size_t)info.st_size;
+    void* base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Cannot map mesh cache: " << path << std::endl;
+        return false;
+    }
+
+    const MeshCacheHeader* header = (const MeshCacheHeader*)base;
+    bool valid = memcmp(header->magic, "MESHBIN", 8) == 0 &&
+                 header->version == MESH_CACHE_VERSION &&
+                 header->key == key &&
+                 header->layout.vertexBytes == vertexBytes &&
+                 (header->layout.indexBytes == 2 || header->layout.indexBytes == 4) &&
+                 size == sizeof(MeshCacheHeader) + header->vertexCount * header->layout.vertexBytes +
+                         header->indexCount * header->layout.indexBytes;
+    if (!valid) {
+        munmap(base, size);
+        std::cerr << "Ignoring stale mesh cache: " << path << std::endl;
+        return false;
+    }
+
+    // Start paging the blobs in while the caller sets up buffers
+    madvise(base, size, MADV_WILLNEED);
+
+    mesh.base = base;
+    mesh.size = size;
+    mesh.vertexCount = header->vertexCount;
+    mesh.indexCount = header->indexCount;
+    mesh.layout = header->layout;
+    mesh.bounds = header->bounds;
+    mesh.vertices = (const uint16_t*)((const char*)base + sizeof(MeshCacheHeader));
+    mesh.indices = (const char*)mesh.vertices + mesh.vertexCount * mesh.layout.vertexBytes;
+    return true;
+}
+
+// Write a compressed mesh to path, exactly as uploaded. The file is
+// written under a temporary name and renamed, so a reader never maps a
+// partial file.
+inline bool writeMeshCache(const std::string& path, uint64_t key, const MeshLayout& layout, const MeshBounds& bounds,
+                           const uint16_t* vertices, size_t vertexCount, const void* indices, size_t indexCount) {
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MESHBIN", 8);
+    header.version = MESH_CACHE_VERSION;
+    header.layout = layout;
+    header.key = key;
+    header.vertexCount = vertexCount;
+    header.indexCount = indexCount;
+    header.bounds = bounds;
+
+    std::string temp = path + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Cannot write mesh cache: " << temp << std::endl;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(vertices, layout.vertexBytes, vertexCount, file) == vertexCount &&
+              fwrite(indices, layout.indexBytes, indexCount, file) == indexCount;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        std::cerr << "Cannot write mesh cache: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,315 @@
+// Index and vertex order optimization for indexed triangle meshes:
+//  - optimizeVertexCache: Tipsify triangle reordering for post-transform
+//    vertex cache reuse (Sander, Nehab, Barczak 2007)
+//  - optimizeVertexFetch: renumber vertices in first-use order so fetches
+//    walk the vertex buffer mostly forward
+//  - analyzeVertexCache: ACMR / ATVR on a simulated FIFO cache
+//  - generateGridStrips: triangle strips with primitive restart for
+//    regular vertex grids
+// plus 16-bit index packing. (CPU only, no OpenGL calls.)
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+// Cache size the optimizer targets and the statistics simulate
+const int VERTEX_CACHE_SIZE = 16;
+
+// Average cache miss ratio: transformed vertices per triangle (0.5 - 3.0)
+// Average transform to vertex ratio: transformed vertices per referenced
+// vertex (1.0 is optimal)
+struct VertexCacheStats {
+    float acmr;
+    float atvr;
+};
+
+// Primitive restart index of 32-bit strip index buffers. packIndices16 maps
+// it to 0xFFFF, the restart index of 16-bit buffers.
+const unsigned int STRIP_RESTART_INDEX = 0xFFFFFFFFu;
+
+inline unsigned int stripRestartIndex(bool sixteenBit) {
+    return sixteenBit ? 0xFFFFu : STRIP_RESTART_INDEX;
+}
+
+// Triangles drawn by strips separated by the restart index (32- or 16-bit)
+template <typename Index>
+size_t countStripTriangles(const Index* indices, size_t indexCount) {
+    const Index restart = (Index)STRIP_RESTART_INDEX;
+    size_t triangles = 0;
+    size_t run = 0;
+    for (size_t i = 0; i <= indexCount; i++) {
+        if (i == indexCount || indices[i] == restart) {
+            triangles += run >= 3 ? run - 2 : 0;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    return triangles;
+}
+
+// Replay indices through a FIFO cache of cacheSize entries. Restart indices
+// are skipped, so strips can be measured by passing their triangle count.
+inline VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                           int cacheSize, size_t triangleCount) {
+    std::vector<unsigned int> stamp(vertexCount, 0);  // Miss counter value when cached
+    std::vector<char> referenced(vertexCount, 0);
+    unsigned int misses = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int v = indices[i];
+        if (v == STRIP_RESTART_INDEX) {
+            continue;
+        }
+        if (!referenced[v]) {
+            referenced[v] = 1;
+            unique++;
+        }
+        // A FIFO entry is evicted after cacheSize further misses
+        if (stamp[v] == 0 || misses - stamp[v] + 1 > (unsigned int)cacheSize) {
+            misses++;
+            stamp[v] = misses;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = triangleCount ? (float)misses / triangleCount : 0.0f;
+    stats.atvr = unique ? (float)misses / unique : 0.0f;
+    return stats;
+}
+
+inline VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                           int cacheSize = VERTEX_CACHE_SIZE) {
+    return analyzeVertexCache(indices, indexCount, vertexCount, cacheSize, indexCount / 3);
+}
+
+inline VertexCacheStats analyzeVertexCacheStrips(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                                 int cacheSize = VERTEX_CACHE_SIZE) {
+    return analyzeVertexCache(indices, indexCount, vertexCount, cacheSize, countStripTriangles(indices, indexCount));
+}
+
+// Reorder triangles in place for vertex cache locality. Tipsify fans around
+// one vertex at a time, emitting all its remaining triangles, then moves to
+// the neighbour that is still in the cache and has the most triangles left;
+// dead ends fall back to recently used vertices, then to input order.
+// Triangle winding is preserved. Linear in the mesh size.
+inline void optimizeVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount,
+                                int cacheSize = VERTEX_CACHE_SIZE) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Vertex -> triangle adjacency (compressed rows)
+    std::vector<unsigned int> live(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        live[indices[i]]++;
+    }
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<unsigned int> adjacency(indexCount);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+        }
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+    long fanning = indices[0];
+
+    while (fanning >= 0) {
+        candidates.clear();
+        for (size_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) {
+                continue;
+            }
+            emitted[t] = 1;
+            for (int k = 0; k < 3; k++) {
+                unsigned int v = indices[t * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > (unsigned int)cacheSize) {
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+        }
+
+        // Best candidate: in cache after its own fan is emitted, oldest first
+        fanning = -1;
+        long bestPriority = -1;
+        for (size_t c = 0; c < candidates.size(); c++) {
+            unsigned int v = candidates[c];
+            if (live[v] == 0) {
+                continue;
+            }
+            long priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= (unsigned int)cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        // Dead end: most recent vertex with triangles left, else the next in order
+        while (fanning < 0 && !deadEnd.empty()) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                fanning = v;
+            }
+        }
+        while (fanning < 0 && cursor < vertexCount) {
+            if (live[cursor] > 0) {
+                fanning = (long)cursor;
+            }
+            cursor++;
+        }
+    }
+
+    memcpy(indices, output.data(), indexCount * sizeof(unsigned int));
+}
+
+// Renumber vertices in order of first use by indices and reorder the
+// `stride`-float vertex array to match. Unreferenced vertices go last.
+inline void optimizeVertexFetch(float* vertices, size_t vertexCount, int stride,
+                                unsigned int* indices, size_t indexCount) {
+    const unsigned int unassigned = 0xFFFFFFFFu;
+    std::vector<unsigned int> remap(vertexCount, unassigned);
+    unsigned int next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        unsigned int& target = remap[indices[i]];
+        if (target == unassigned) {
+            target = next++;
+        }
+        indices[i] = target;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (remap[v] == unassigned) {
+            remap[v] = next++;
+        }
+    }
+
+    std::vector<float> reordered(vertexCount * stride);
+    for (size_t v = 0; v < vertexCount; v++) {
+        memcpy(&reordered[remap[v] * stride], vertices + v * stride, stride * sizeof(float));
+    }
+    memcpy(vertices, reordered.data(), reordered.size() * sizeof(float));
+}
+
+inline void printVertexCacheStats(const char* name, const VertexCacheStats& before, const VertexCacheStats& after,
+                                  size_t vertexCount) {
+    std::cout << "Vertex cache " << name << ": ACMR " << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr << " (" << VERTEX_CACHE_SIZE
+              << "-entry FIFO), " << (vertexCount <= 65535 ? 16 : 32) << "-bit indices" << std::endl;
+}
+
+// Reorder triangles (and vertices, when vertices is non-null) and optionally
+// print ACMR / ATVR before and after
+inline void optimizeMesh(const char* name, float* vertices, size_t vertexCount, int stride,
+                         std::vector<unsigned int>& indices, bool report) {
+    VertexCacheStats before = {0.0f, 0.0f};
+    if (report) {
+        before = analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    }
+    optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    if (vertices) {
+        optimizeVertexFetch(vertices, vertexCount, stride, indices.data(), indices.size());
+    }
+    if (report) {
+        printVertexCacheStats(name, before, analyzeVertexCache(indices.data(), indices.size(), vertexCount),
+                              vertexCount);
+    }
+}
+
+// 16-bit indices when every vertex is addressable with them. 0xFFFF stays
+// free even for triangle lists: the programs keep GL_PRIMITIVE_RESTART on
+// for every draw, so a vertex 65535 would be read as a restart.
+inline bool indicesFit16(size_t vertexCount) {
+    return vertexCount <= 65535u;
+}
+
+inline void packIndices16(const unsigned int* indices, size_t indexCount, std::vector<uint16_t>& packed) {
+    packed.resize(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        packed[i] = (uint16_t)indices[i];
+    }
+}
+
+// Quads per strip for a grid `columns` quads wide. The grid is cut into
+// column bands narrow enough that a whole strip (both vertex rows) fits a
+// cacheSize-entry FIFO, so the strip below finds its top row still cached.
+inline int gridStripBandWidth(int columns, int cacheSize = VERTEX_CACHE_SIZE) {
+    int maxWidth = std::max(1, cacheSize / 2 - 1);
+    int bands = (columns + maxWidth - 1) / maxWidth;
+    return (columns + bands - 1) / bands;
+}
+
+// Indices generateGridStrips writes for a columns x rows quad grid
+inline size_t gridStripIndexCount(int columns, int rows) {
+    int width = gridStripBandWidth(columns);
+    size_t bands = (columns + width - 1) / width;
+    return (size_t)rows * (2 * (columns + bands) + bands);
+}
+
+// Strips over a (columns+1) x (rows+1) row-major vertex grid starting at
+// vertex base: for each column band, one strip per quad row, each followed
+// by STRIP_RESTART_INDEX. Triangles match the usual list order
+// (top-left, bottom-left, top-right), (top-right, bottom-left, bottom-right),
+// winding included. Writes gridStripIndexCount(columns, rows) indices.
+inline void generateGridStrips(unsigned int base, int columns, int rows, unsigned int* out) {
+    int width = gridStripBandWidth(columns);
+    for (int first = 0; first < columns; first += width) {
+        int last = std::min(first + width, columns);
+        for (int j = 0; j < rows; j++) {
+            unsigned int top = base + j * (columns + 1);
+            unsigned int bottom = top + columns + 1;
+            for (int i = first; i <= last; i++) {
+                *out++ = top + i;
+                *out++ = bottom + i;
+            }
+            *out++ = STRIP_RESTART_INDEX;
+        }
+    }
+}
+
+// Strips for `blocks` grids stored one after another, each
+// (columns+1) x (rows+1) vertices (e.g. one block per Bezier patch)
+inline void generateGridStripBlocks(int blocks, int columns, int rows, std::vector<unsigned int>& indices) {
+    size_t blockIndices = gridStripIndexCount(columns, rows);
+    indices.resize(blocks * blockIndices);
+    for (int b = 0; b < blocks; b++) {
+        generateGridStrips((unsigned int)b * (columns + 1) * (rows + 1), columns, rows,
+                           indices.data() + b * blockIndices);
+    }
+}
+
+inline void printStripStats(const char* name, const unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    size_t triangles = countStripTriangles(indices, indexCount);
+    VertexCacheStats stats = analyzeVertexCacheStrips(indices, indexCount, vertexCount);
+    std::cout << "Strips " << name << ": " << indexCount << " indices for " << triangles << " triangles ("
+              << triangles * 3 << " as a list), ACMR " << stats.acmr << ", ATVR " << stats.atvr << ", "
+              << (indicesFit16(vertexCount) ? 16 : 32) << "-bit indices" << std::endl;
+}
+
+#endif
@@ -0,0 +1,369 @@
+// Parametric surfaces sampled on a (columns+1) x (rows+1) vertex grid:
+// torus, sphere, cylinder, cone, superquadric and multi-patch Bezier
+// surfaces. Vertices are position + normal (6 floats, plus u, v for Bezier
+// surfaces on request), row-major, indexed as triangle strips
+// (generateGridStrips in mesh_optimizer.h).
+//
+// Angles are read from per-axis sin/cos tables built once per mesh, so a
+// grid costs columns + rows trig calls instead of two per vertex. Outputs
+// are written into arrays sized up front and rows are split across the
+// shared thread pool (thread_pool.h).
+//
+// generateParametricLods / generateBezierLods pack a level-of-detail chain
+// (full, 1/2, 1/4, 1/8 segments) into one vertex and one index array, and
+// selectLod picks a level from the projected size of the mesh.
+// (CPU only, no OpenGL calls.)
+#ifndef PARAMETRIC_MESH_H
+#define PARAMETRIC_MESH_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "thread_pool.h"
+#include "bezier_surface.h"
+#include "mesh_optimizer.h"
+
+enum ParametricShape {
+    SHAPE_TORUS,
+    SHAPE_SPHERE,
+    SHAPE_CYLINDER,
+    SHAPE_CONE,
+    SHAPE_SUPERQUADRIC,
+    SHAPE_COUNT
+};
+
+inline const char* parametricShapeName(ParametricShape shape) {
+    static const char* names[SHAPE_COUNT] = {"torus", "sphere", "cylinder", "cone", "superquadric"};
+    return names[shape];
+}
+
+// Shape and sampling. Rows run along the first parameter (torus major
+// angle, sphere / superquadric latitude from +z, cylinder / cone height
+// from the top), columns along the second (the angle around z).
+struct ParametricParams {
+    ParametricShape shape;
+    int columns;
+    int rows;
+    float radius;        // Torus major radius; sphere, cylinder, cone, superquadric radius
+    float minorRadius;   // Torus tube radius
+    float height;        // Cylinder and cone (cone apex at +height / 2)
+    float exponentRows;  // Superquadric squareness along rows (1 = sphere)
+    float exponentColumns;  // and around z
+};
+
+// 32 x 16 segments around / along each shape, sized to fill the same view
+inline ParametricParams defaultParametricParams(ParametricShape shape) {
+    bool torus = (shape == SHAPE_TORUS);
+    ParametricParams params;
+    params.shape = shape;
+    params.columns = torus ? 16 : 32;
+    params.rows = torus ? 32 : 16;
+    params.radius = torus ? 1.5f : 1.2f;
+    params.minorRadius = 0.5f;
+    params.height = 2.4f;
+    params.exponentRows = 0.3f;
+    params.exponentColumns = 0.3f;
+    return params;
+}
+
+inline size_t parametricVertexCount(const ParametricParams& params) {
+    return (size_t)(params.columns + 1) * (params.rows + 1);
+}
+
+// sign(x) |x|^exponent (superquadric profiles)
+inline float signedPower(float x, float exponent) {
+    float magnitude = std::pow(std::fabs(x), exponent);
+    return x < 0.0f ? -magnitude : magnitude;
+}
+
+// sin and cos of start + range * i / segments for i = 0..segments, raised
+// to `exponent` with signedPower. A full turn repeats its first sample
+// exactly at the seam.
+struct TrigTable {
+    std::vector<float> sin, cos;
+
+    void build(int segments, float start, float range, float exponent = 1.0f) {
+        sin.resize(segments + 1);
+        cos.resize(segments + 1);
+        for (int i = 0; i <= segments; i++) {
+            float angle = start + range * i / segments;
+            sin[i] = std::sin(angle);
+            cos[i] = std::cos(angle);
+            if (exponent != 1.0f) {
+                sin[i] = signedPower(sin[i], exponent);
+                cos[i] = signedPower(cos[i], exponent);
+            }
+        }
+        if (std::fabs(range - 2.0f * (float)M_PI) < 1e-6f) {
+            sin[segments] = sin[0];
+            cos[segments] = cos[0];
+        }
+    }
+};
+
+inline void writeParametricVertex(float* out, float x, float y, float z, float nx, float ny, float nz) {
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+    out[3] = nx;
+    out[4] = ny;
+    out[5] = nz;
+}
+
+// Vertex rows [rowBegin, rowEnd) of the grid. rowTable / columnTable hold
+// the position profiles, rowNormals / columnNormals the normal profiles
+// (the same tables except for superquadrics).
+inline void generateParametricRows(const ParametricParams& params, const TrigTable& rowTable,
+                                   const TrigTable& columnTable, const TrigTable& rowNormals,
+                                   const TrigTable& columnNormals, int rowBegin, int rowEnd, float* vertices) {
+    int columns = params.columns;
+    float r = params.radius;
+    float h = params.height;
+    // Cone side normal: (h cos, h sin, r), normalized
+    float coneLength = std::sqrt(h * h + r * r);
+    float coneRadial = coneLength > 0.0f ? h / coneLength : 0.0f;
+    float coneAxial = coneLength > 0.0f ? r / coneLength : 1.0f;
+
+    // One loop per shape keeps the switch out of the per-vertex path
+    for (int i = rowBegin; i < rowEnd; i++) {
+        float* out = vertices + (size_t)i * (columns + 1) * 6;
+        float t = (float)i / params.rows;
+        const float* cosC = columnTable.cos.data();
+        const float* sinC = columnTable.sin.data();
+        switch (params.shape) {
+            case SHAPE_TORUS: {
+                float cosU = rowTable.cos[i];
+                float sinU = rowTable.sin[i];
+                for (int j = 0; j <= columns; j++, out += 6) {
+                    float ring = r + params.minorRadius * cosC[j];
+                    writeParametricVertex(out, ring * cosU, ring * sinU, params.minorRadius * sinC[j],
+                                          cosC[j] * cosU, cosC[j] * sinU, sinC[j]);
+                }
+                break;
+            }
+            case SHAPE_SPHERE: {
+                float sinT = rowTable.sin[i];
+                float cosT = rowTable.cos[i];
+                for (int j = 0; j <= columns; j++, out += 6) {
+                    writeParametricVertex(out, r * sinT * cosC[j], r * sinT * sinC[j], r * cosT,
+                                          sinT * cosC[j], sinT * sinC[j], cosT);
+                }
+                break;
+            }
+            case SHAPE_CYLINDER: {
+                float z = h * (0.5f - t);
+                for (int j = 0; j <= columns; j++, out += 6) {
+                    writeParametricVertex(out, r * cosC[j], r * sinC[j], z, cosC[j], sinC[j], 0.0f);
+                }
+                break;
+            }
+            case SHAPE_CONE: {
+                float z = h * (0.5f - t);
+                for (int j = 0; j <= columns; j++, out += 6) {
+                    writeParametricVertex(out, r * t * cosC[j], r * t * sinC[j], z,
+                                          coneRadial * cosC[j], coneRadial * sinC[j], coneAxial);
+                }
+                break;
+            }
+            default: {
+                float sinT = rowTable.sin[i];
+                float cosT = rowTable.cos[i];
+                float normalSinT = rowNormals.sin[i];
+                float normalCosT = rowNormals.cos[i];
+                for (int j = 0; j <= columns; j++, out += 6) {
+                    float nx = normalSinT * columnNormals.cos[j];
+                    float ny = normalSinT * columnNormals.sin[j];
+                    float length = std::sqrt(nx * nx + ny * ny + normalCosT * normalCosT);
+                    float inverse = length > 1e-20f ? 1.0f / length : 0.0f;
+                    writeParametricVertex(out, r * sinT * cosC[j], r * sinT * sinC[j], r * cosT,
+                                          nx * inverse, ny * inverse, normalCosT * inverse);
+                }
+                break;
+            }
+        }
+    }
+}
+
+// Fill vertices (parametricVertexCount(params) * 6 floats) using `threads`
+// threads
+inline void generateParametricVertices(const ParametricParams& params, int threads, float* vertices) {
+    const float turn = 2.0f * (float)M_PI;
+    TrigTable rowTable, columnTable, rowNormals, columnNormals;
+    switch (params.shape) {
+        case SHAPE_TORUS:
+            rowTable.build(params.rows, 0.0f, turn);
+            columnTable.build(params.columns, 0.0f, turn);
+            break;
+        case SHAPE_SUPERQUADRIC:
+            rowTable.build(params.rows, 0.0f, (float)M_PI, params.exponentRows);
+            columnTable.build(params.columns, 0.0f, turn, params.exponentColumns);
+            rowNormals.build(params.rows, 0.0f, (float)M_PI, 2.0f - params.exponentRows);
+            columnNormals.build(params.columns, 0.0f, turn, 2.0f - params.exponentColumns);
+            break;
+        case SHAPE_SPHERE:
+            rowTable.build(params.rows, 0.0f, (float)M_PI);
+            columnTable.build(params.columns, 0.0f, turn);
+            break;
+        default:
+            columnTable.build(params.columns, 0.0f, turn);
+            break;
+    }
+
+    const ParametricParams* shape = &params;
+    const TrigTable* tables[4] = {&rowTable, &columnTable, &rowNormals, &columnNormals};
+    parallelRanges(params.rows + 1, threads, [=](int rowBegin, int rowEnd) {
+        generateParametricRows(*shape, *tables[0], *tables[1], *tables[2], *tables[3], rowBegin, rowEnd, vertices);
+    });
+}
+
+// Vertices and strip indices of a parametric shape. The vectors are only
+// reallocated when the grid grows.
+inline void generateParametricMesh(const ParametricParams& params, int threads,
+                                   std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    vertices.resize(parametricVertexCount(params) * 6);
+    generateParametricVertices(params, threads, vertices.data());
+    generateGridStripBlocks(1, params.columns, params.rows, indices);
+}
+
+// Vertices and strip indices of a Bezier surface at res x res quads per
+// patch (tessellateBezierSurface in bezier_surface.h; 8 floats per vertex
+// with texture coordinates)
+inline void generateBezierMesh(const BezierSurface& surface, int res, bool texCoords, int threads,
+                               std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    tessellateBezierSurface(surface, res, texCoords, threads, vertices, indices, false);
+    generateGridStripBlocks(surface.patchCount(), res, res, indices);
+}
+
+// Level of detail chains. Level l has the level 0 segment counts halved l
+// times (clamped to MIN_LOD_SEGMENTS); the chain stops early once halving
+// no longer changes the grid. All levels share one vertex array and one
+// index array. Each level's indices count from its own first vertex, so a
+// level is drawn with glDrawElementsBaseVertex(firstVertex) and keeps
+// 16-bit indices whenever level 0 does.
+const int MAX_LOD_LEVELS = 4;
+const int MIN_LOD_SEGMENTS = 4;
+
+// Screen length (pixels) a segment may reach before selectLod refines
+const float LOD_SEGMENT_PIXELS = 8.0f;
+
+struct MeshLod {
+    int columns, rows;  // Quads per block
+    size_t firstVertex, vertexCount;
+    size_t firstIndex, indexCount;
+    size_t triangleCount;
+};
+
+inline int lodSegments(int segments, int level) {
+    return std::max(std::min(segments, MIN_LOD_SEGMENTS), segments >> level);
+}
+
+// Layout of the chain for `blocks` grids of columns x rows quads at level 0
+inline void buildLodChain(int blocks, int columns, int rows, std::vector<MeshLod>& lods) {
+    lods.clear();
+    size_t vertices = 0, indices = 0;
+    for (int level = 0; level < MAX_LOD_LEVELS; level++) {
+        MeshLod lod;
+        lod.columns = lodSegments(columns, level);
+        lod.rows = lodSegments(rows, level);
+        if (!lods.empty() && lod.columns == lods.back().columns && lod.rows == lods.back().rows) {
+            break;
+        }
+        lod.firstVertex = vertices;
+        lod.vertexCount = (size_t)blocks * (lod.columns + 1) * (lod.rows + 1);
+        lod.firstIndex = indices;
+        lod.indexCount = blocks * gridStripIndexCount(lod.columns, lod.rows);
+        lod.triangleCount = (size_t)blocks * lod.columns * lod.rows * 2;
+        vertices += lod.vertexCount;
+        indices += lod.indexCount;
+        lods.push_back(lod);
+    }
+}
+
+inline size_t lodChainVertexCount(const std::vector<MeshLod>& lods) {
+    return lods.back().firstVertex + lods.back().vertexCount;
+}
+
+inline size_t lodChainIndexCount(const std::vector<MeshLod>& lods) {
+    return lods.back().firstIndex + lods.back().indexCount;
+}
+
+// Strip indices of every level, each relative to the level's first vertex
+inline void generateLodIndices(int blocks, const std::vector<MeshLod>& lods, std::vector<unsigned int>& indices) {
+    indices.resize(lodChainIndexCount(lods));
+    std::vector<unsigned int> level;
+    for (size_t l = 0; l < lods.size(); l++) {
+        generateGridStripBlocks(blocks, lods[l].columns, lods[l].rows, level);
+        std::copy(level.begin(), level.end(), indices.begin() + lods[l].firstIndex);
+    }
+}
+
+// Coarsest level whose segments stay within segmentPixels on screen for a
+// mesh of bounding radius `radius` at `distance` from the eye, seen with a
+// vertical field of view fovY (degrees) on a viewport `viewportHeight`
+// pixels tall. A segment is approximated as the full projected
+// circumference (pi times the projected diameter) over the larger segment
+// count.
+inline int selectLod(const std::vector<MeshLod>& lods, float radius, float distance, float fovY,
+                     int viewportHeight, float segmentPixels = LOD_SEGMENT_PIXELS) {
+    if (distance <= radius) {
+        return 0;
+    }
+    float halfHeight = distance * std::tan(fovY * 0.5f * (float)M_PI / 180.0f);
+    float diameter = radius / halfHeight * viewportHeight;
+    for (int level = (int)lods.size() - 1; level > 0; level--) {
+        float segment = (float)M_PI * diameter / std::max(lods[level].columns, lods[level].rows);
+        if (segment <= segmentPixels) {
+            return level;
+        }
+    }
+    return 0;
+}
+
+inline void printLodChain(const char* name, const std::vector<MeshLod>& lods) {
+    std::cout << "LOD chain " << name << ":";
+    for (size_t l = 0; l < lods.size(); l++) {
+        std::cout << (l ? ", " : " ") << lods[l].columns << "x" << lods[l].rows << " (" << lods[l].triangleCount
+                  << " triangles)";
+    }
+    std::cout << ", " << lodChainVertexCount(lods) << " vertices in total" << std::endl;
+}
+
+// LOD chain of a parametric shape: lods describes the layout, vertices
+// holds every level's grid back to back, indices their strips
+inline void generateParametricLods(const ParametricParams& params, int threads, std::vector<MeshLod>& lods,
+                                   std::vector<float>& vertices, std::vector<unsigned int>& indices) {
+    buildLodChain(1, params.columns, params.rows, lods);
+    vertices.resize(lodChainVertexCount(lods) * 6);
+    for (size_t l = 0; l < lods.size(); l++) {
+        ParametricParams level = params;
+        level.columns = lods[l].columns;
+        level.rows = lods[l].rows;
+        generateParametricVertices(level, threads, vertices.data() + lods[l].firstVertex * 6);
+    }
+    generateLodIndices(1, lods, indices);
+}
+
+// LOD chain of a Bezier surface starting at res x res quads per patch
+inline void generateBezierLods(const BezierSurface& surface, int res, bool texCoords, int threads,
+                               std::vector<MeshLod>& lods, std::vector<float>& vertices,
+                               std::vector<unsigned int>& indices) {
+    int patches = surface.patchCount();
+    int stride = surfaceVertexStride(texCoords);
+    buildLodChain(patches, res, res, lods);
+    vertices.resize(lodChainVertexCount(lods) * stride);
+    for (size_t l = 0; l < lods.size(); l++) {
+        int levelRes = lods[l].columns;
+        size_t patchFloats = (size_t)(levelRes + 1) * (levelRes + 1) * stride;
+        float* level = vertices.data() + lods[l].firstVertex * stride;
+        const BezierSurface* source = &surface;
+        parallelRanges(patches, threads, [=](int begin, int end) {
+            for (int p = begin; p < end; p++) {
+                tessellateSurfacePatch(*source, p, levelRes, texCoords, level + p * patchFloats);
+            }
+        });
+    }
+    generateLodIndices(patches, lods, indices);
+}
+
+#endif
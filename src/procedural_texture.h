@@ -0,0 +1,303 @@
+// Procedural texture for the Bezier patch: the spiral/wave pattern and its
+// whole mip chain, built on the CPU in one parallel pass.
+//  - the image is cut into TEXTURE_TILE_SIZE tiles split across the shared
+//    thread pool (thread_pool.h); rows are shaded 4 texels at a time with
+//    SSE (scalar tail and fallback do the same operations in the same
+//    order, so output is identical)
+//  - sin and atan2 are polynomials (error below 1e-5, far under one 8-bit
+//    step); the terms that only depend on x or y come from per-axis tables
+//  - each tile box-filters its own part of mip levels 1..TEXTURE_TILE_LEVELS
+//    while it is still in cache; the few small levels left are built from
+//    the last of those afterwards
+// Levels are RGB8, tightly packed (upload with GL_UNPACK_ALIGNMENT 1); level
+// sizes follow GL: max(1, size >> level).
+// (CPU only, no OpenGL calls.)
+#ifndef PROCEDURAL_TEXTURE_H
+#define PROCEDURAL_TEXTURE_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "simd_math.h"
+#include "thread_pool.h"
+
+const int TEXTURE_TILE_SIZE = 64;
+const int TEXTURE_TILE_LEVELS = 6;  // log2(TEXTURE_TILE_SIZE)
+const int MAX_PROCEDURAL_TEXTURE_SIZE = 8192;
+
+struct TextureMipChain {
+    std::vector<int> widths, heights;
+    std::vector<std::vector<unsigned char>> levels;
+};
+
+// floor(log2(max(width, height))) + 1
+inline int mipLevelCount(int width, int height) {
+    int size = std::max(width, height);
+    int count = 1;
+    while (size > 1) {
+        size >>= 1;
+        count++;
+    }
+    return count;
+}
+
+// sin(x) for |x| up to a few hundred: reduce to [-pi, pi], fold to
+// [0, pi/2] (sin(pi - a) = sin(a)), then a degree 9 odd polynomial
+inline float polySin(float x) {
+    const float TWO_PI = 6.28318530717958647692f;
+    const float INV_TWO_PI = 0.15915494309189533577f;
+    const float PI = 3.14159265358979323846f;
+    float n = std::nearbyint(x * INV_TWO_PI);
+    float r = x - n * TWO_PI;
+    float a = std::fabs(r);
+    a = std::min(a, PI - a);
+    float s = a * a;
+    float p = a * (1.0f + s * (-1.0f / 6.0f + s * (1.0f / 120.0f + s * (-1.0f / 5040.0f + s * (1.0f / 362880.0f)))));
+    return std::copysign(p, r);
+}
+
+// atan2(y, x): atan of min/max on [0, 1] (Hastings' degree 9 polynomial),
+// then moved to the right octant
+inline float polyAtan2(float y, float x) {
+    const float PI = 3.14159265358979323846f;
+    const float HALF_PI = 1.57079632679489661923f;
+    float ax = std::fabs(x);
+    float ay = std::fabs(y);
+    float a = std::min(ax, ay) / std::max(std::max(ax, ay), 1e-30f);
+    float s = a * a;
+    float r = a * (0.9998660f + s * (-0.3302995f + s * (0.1801410f + s * (-0.0851330f + s * 0.0208351f))));
+    if (ay > ax) {
+        r = HALF_PI - r;
+    }
+    if (x < 0.0f) {
+        r = PI - r;
+    }
+    return std::copysign(r, y);
+}
+
+#ifdef SIMD_MATH_X86
+
+inline __m128 signBitsSSE(__m128 v) {
+    return _mm_and_ps(v, _mm_set1_ps(-0.0f));
+}
+
+inline __m128 polySinSSE(__m128 x) {
+    const __m128 TWO_PI = _mm_set1_ps(6.28318530717958647692f);
+    const __m128 INV_TWO_PI = _mm_set1_ps(0.15915494309189533577f);
+    const __m128 PI = _mm_set1_ps(3.14159265358979323846f);
+    // cvtps2dq rounds to nearest even, like nearbyint in the default mode
+    __m128 n = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, INV_TWO_PI)));
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(n, TWO_PI));
+    __m128 sign = signBitsSSE(r);
+    __m128 a = _mm_andnot_ps(_mm_set1_ps(-0.0f), r);
+    a = _mm_min_ps(a, _mm_sub_ps(PI, a));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 p = _mm_add_ps(_mm_set1_ps(-1.0f / 5040.0f), _mm_mul_ps(s, _mm_set1_ps(1.0f / 362880.0f)));
+    p = _mm_add_ps(_mm_set1_ps(1.0f / 120.0f), _mm_mul_ps(s, p));
+    p = _mm_add_ps(_mm_set1_ps(-1.0f / 6.0f), _mm_mul_ps(s, p));
+    p = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(s, p));
+    return _mm_or_ps(_mm_mul_ps(a, p), sign);
+}
+
+inline __m128 polyAtan2SSE(__m128 y, __m128 x) {
+    const __m128 PI = _mm_set1_ps(3.14159265358979323846f);
+    const __m128 HALF_PI = _mm_set1_ps(1.57079632679489661923f);
+    __m128 ax = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    __m128 ay = _mm_andnot_ps(_mm_set1_ps(-0.0f), y);
+    __m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+    __m128 s = _mm_mul_ps(a, a);
+    __m128 p = _mm_add_ps(_mm_set1_ps(-0.0851330f), _mm_mul_ps(s, _mm_set1_ps(0.0208351f)));
+    p = _mm_add_ps(_mm_set1_ps(0.1801410f), _mm_mul_ps(s, p));
+    p = _mm_add_ps(_mm_set1_ps(-0.3302995f), _mm_mul_ps(s, p));
+    p = _mm_add_ps(_mm_set1_ps(0.9998660f), _mm_mul_ps(s, p));
+    __m128 r = _mm_mul_ps(a, p);
+    __m128 steep = _mm_cmpgt_ps(ay, ax);
+    r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(HALF_PI, r)), _mm_andnot_ps(steep, r));
+    __m128 behind = _mm_cmplt_ps(x, _mm_setzero_ps());
+    r = _mm_or_ps(_mm_and_ps(behind, _mm_sub_ps(PI, r)), _mm_andnot_ps(behind, r));
+    // r >= 0 here, so copysign is an OR of y's sign bit
+    return _mm_or_ps(r, signBitsSSE(y));
+}
+
+#endif
+
+// sin(t * scale) for t = i / count, i in [0, count)
+inline void fillSinTable(int count, float scale, std::vector<float>& table) {
+    table.resize(count);
+    for (int i = 0; i < count; i++) {
+        table[i] = std::sin((float)i / count * scale);
+    }
+}
+
+// Per-axis terms of the pattern: wave2 = sin(8 pi x) sin(8 pi y), and
+// wave3 = sin(6 pi (x + y)) = sin(6 pi x) cos(6 pi y) + cos(6 pi x) sin(6 pi y)
+struct TexturePatternTables {
+    std::vector<float> dx, dy;  // Texel coordinate - 0.5
+    std::vector<float> sin8X, sin6X, cos6X;
+    std::vector<float> sin8Y, sin6Y, cos6Y;
+
+    TexturePatternTables(int width, int height) {
+        const float PI = 3.14159265358979323846f;
+        dx.resize(width);
+        for (int x = 0; x < width; x++) {
+            dx[x] = (float)x / width - 0.5f;
+        }
+        dy.resize(height);
+        for (int y = 0; y < height; y++) {
+            dy[y] = (float)y / height - 0.5f;
+        }
+        fillSinTable(width, 8.0f * PI, sin8X);
+        fillSinTable(width, 6.0f * PI, sin6X);
+        fillSinTable(height, 8.0f * PI, sin8Y);
+        fillSinTable(height, 6.0f * PI, sin6Y);
+        cos6X.resize(width);
+        for (int x = 0; x < width; x++) {
+            cos6X[x] = std::cos((float)x / width * 6.0f * PI);
+        }
+        cos6Y.resize(height);
+        for (int y = 0; y < height; y++) {
+            cos6Y[y] = std::cos((float)y / height * 6.0f * PI);
+        }
+    }
+};
+
+inline unsigned char toTextureByte(float v) {
+    return (unsigned char)std::min(255.0f, std::max(0.0f, v * 255.0f));
+}
+
+// Texels [x0, x1) of row y into out (RGB8)
+inline void shadePatternSpan(const TexturePatternTables& t, int y, int x0, int x1, unsigned char* out) {
+    float dy = t.dy[y];
+    float sin8Y = t.sin8Y[y], sin6Y = t.sin6Y[y], cos6Y = t.cos6Y[y];
+    int x = x0;
+#ifdef SIMD_MATH_X86
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 full = _mm_set1_ps(255.0f);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 dy4 = _mm_set1_ps(dy);
+    __m128 dyy4 = _mm_mul_ps(dy4, dy4);
+    for (; x + 4 <= x1; x += 4) {
+        __m128 dx4 = _mm_loadu_ps(&t.dx[x]);
+        __m128 angle = polyAtan2SSE(dy4, dx4);
+        __m128 radius = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx4, dx4), dyy4));
+        __m128 arg = _mm_add_ps(_mm_mul_ps(radius, _mm_set1_ps(10.0f)), _mm_mul_ps(angle, _mm_set1_ps(3.0f)));
+        __m128 wave1 = _mm_add_ps(_mm_mul_ps(polySinSSE(arg), half), half);
+        __m128 wave2 = _mm_mul_ps(_mm_loadu_ps(&t.sin8X[x]), _mm_set1_ps(sin8Y));
+        wave2 = _mm_add_ps(_mm_mul_ps(wave2, half), half);
+        __m128 wave3 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&t.sin6X[x]), _mm_set1_ps(cos6Y)),
+                                  _mm_mul_ps(_mm_loadu_ps(&t.cos6X[x]), _mm_set1_ps(sin6Y)));
+        wave3 = _mm_add_ps(_mm_mul_ps(wave3, half), half);
+
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wave1, _mm_set1_ps(0.4f)), _mm_mul_ps(wave2, _mm_set1_ps(0.3f))),
+                              _mm_mul_ps(wave3, _mm_set1_ps(0.3f)));
+        __m128 g = _mm_add_ps(_mm_mul_ps(wave2, half), _mm_mul_ps(wave3, half));
+        __m128 b = _mm_add_ps(_mm_mul_ps(wave1, _mm_set1_ps(0.6f)), _mm_mul_ps(wave3, _mm_set1_ps(0.4f)));
+        alignas(16) int rgb[3][4];
+        _mm_store_si128((__m128i*)rgb[0], _mm_cvttps_epi32(_mm_min_ps(full, _mm_max_ps(zero, _mm_mul_ps(r, full)))));
+        _mm_store_si128((__m128i*)rgb[1], _mm_cvttps_epi32(_mm_min_ps(full, _mm_max_ps(zero, _mm_mul_ps(g, full)))));
+        _mm_store_si128((__m128i*)rgb[2], _mm_cvttps_epi32(_mm_min_ps(full, _mm_max_ps(zero, _mm_mul_ps(b, full)))));
+        unsigned char* texel = out + (size_t)(x - x0) * 3;
+        for (int i = 0; i < 4; i++) {
+            texel[i * 3] = (unsigned char)rgb[0][i];
+            texel[i * 3 + 1] = (unsigned char)rgb[1][i];
+            texel[i * 3 + 2] = (unsigned char)rgb[2][i];
+        }
+    }
+#endif
+    for (; x < x1; x++) {
+        float dx = t.dx[x];
+        float angle = polyAtan2(dy, dx);
+        float radius = std::sqrt(dx * dx + dy * dy);
+        float wave1 = polySin(radius * 10.0f + angle * 3.0f) * 0.5f + 0.5f;
+        float wave2 = t.sin8X[x] * sin8Y * 0.5f + 0.5f;
+        float wave3 = (t.sin6X[x] * cos6Y + t.cos6X[x] * sin6Y) * 0.5f + 0.5f;
+
+        unsigned char* texel = out + (size_t)(x - x0) * 3;
+        texel[0] = toTextureByte(wave1 * 0.4f + wave2 * 0.3f + wave3 * 0.3f);
+        texel[1] = toTextureByte(wave2 * 0.5f + wave3 * 0.5f);
+        texel[2] = toTextureByte(wave1 * 0.6f + wave3 * 0.4f);
+    }
+}
+
+// Box-filter texels [x0, x1) x [y0, y1) of chain level `level` from the
+// level above. Odd sizes drop the last source row/column, as GL's sizes do.
+inline void downsampleMipBlock(TextureMipChain& chain, int level, int x0, int x1, int y0, int y1) {
+    const unsigned char* src = chain.levels[level - 1].data();
+    unsigned char* dst = chain.levels[level].data();
+    int srcWidth = chain.widths[level - 1];
+    int srcHeight = chain.heights[level - 1];
+    int width = chain.widths[level];
+    for (int y = y0; y < y1; y++) {
+        const unsigned char* row0 = src + (size_t)(2 * y) * srcWidth * 3;
+        const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, srcHeight - 1) * srcWidth * 3;
+        unsigned char* line = dst + (size_t)y * width * 3;
+        for (int x = x0; x < x1; x++) {
+            int a = 2 * x * 3;
+            int b = std::min(2 * x + 1, srcWidth - 1) * 3;
+            for (int c = 0; c < 3; c++) {
+                line[x * 3 + c] = (unsigned char)((row0[a + c] + row0[b + c] + row1[a + c] + row1[b + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+// Level 0 of one tile, then its share of the levels below. Tile edges sit
+// on multiples of TEXTURE_TILE_SIZE, so down to TEXTURE_TILE_LEVELS a tile
+// only reads texels it wrote itself; the last tile in a row or column
+// keeps the level's remainder.
+inline void buildTextureTile(const TexturePatternTables& tables, TextureMipChain& chain, int x0, int x1, int y0, int y1) {
+    int width = chain.widths[0];
+    int height = chain.heights[0];
+    for (int y = y0; y < y1; y++) {
+        shadePatternSpan(tables, y, x0, x1, &chain.levels[0][((size_t)y * width + x0) * 3]);
+    }
+    int levels = std::min((int)chain.levels.size() - 1, TEXTURE_TILE_LEVELS);
+    for (int level = 1; level <= levels; level++) {
+        int lx0 = x0 >> level;
+        int ly0 = y0 >> level;
+        int lx1 = x1 == width ? chain.widths[level] : x1 >> level;
+        int ly1 = y1 == height ? chain.heights[level] : y1 >> level;
+        if (lx0 >= lx1 || ly0 >= ly1) {
+            break;
+        }
+        downsampleMipBlock(chain, level, lx0, lx1, ly0, ly1);
+    }
+}
+
+// Fill chain with the width x height pattern and its full mip chain
+inline void generateProceduralTexture(int width, int height, int threads, TextureMipChain& chain) {
+    int levels = mipLevelCount(width, height);
+    chain.widths.resize(levels);
+    chain.heights.resize(levels);
+    chain.levels.resize(levels);
+    for (int level = 0; level < levels; level++) {
+        chain.widths[level] = std::max(1, width >> level);
+        chain.heights[level] = std::max(1, height >> level);
+        chain.levels[level].resize((size_t)chain.widths[level] * chain.heights[level] * 3);
+    }
+
+    TexturePatternTables tables(width, height);
+    int tilesX = (width + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    int tilesY = (height + TEXTURE_TILE_SIZE - 1) / TEXTURE_TILE_SIZE;
+    int tiles = tilesX * tilesY;
+    const TexturePatternTables* source = &tables;
+    TextureMipChain* target = &chain;
+    auto work = [=](int begin, int end) {
+        for (int tile = begin; tile < end; tile++) {
+            int x0 = tile % tilesX * TEXTURE_TILE_SIZE;
+            int y0 = tile / tilesX * TEXTURE_TILE_SIZE;
+            buildTextureTile(*source, *target, x0, std::min(width, x0 + TEXTURE_TILE_SIZE),
+                             y0, std::min(height, y0 + TEXTURE_TILE_SIZE));
+        }
+    };
+
+    parallelRanges(tiles, threads, work);
+
+    // At most 64 x 64 texels left, not worth the threads
+    for (int level = TEXTURE_TILE_LEVELS + 1; level < levels; level++) {
+        downsampleMipBlock(chain, level, 0, chain.widths[level], 0, chain.heights[level]);
+    }
+}
+
+#endif
@@ -0,0 +1,307 @@
+// Ray casting against bounding volume hierarchies, for picking on the CPU:
+//  - screenRay: the ray through a window pixel for a view and projection
+//  - Bvh: binary tree over axis-aligned boxes (median split on the longest
+//    centroid axis, up to BVH_LEAF_SIZE items per leaf), traversed front to
+//    back so hits prune the rest of the tree
+//  - BvhMesh: an indexed triangle mesh with a Bvh over its triangles
+// Instanced scenes use two levels: a Bvh over the instances' world boxes,
+// and per candidate instance the mesh Bvh with the ray in object space.
+// (CPU only, no OpenGL calls.)
+#ifndef RAY_PICKING_H
+#define RAY_PICKING_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include "simd_math.h"
+
+const int BVH_LEAF_SIZE = 4;
+
+// Unit direction for screenRay; transformRay keeps the length, so t stays
+// the same parameter along the ray in every space
+struct Ray {
+    Vec3 origin;
+    Vec3 direction;
+};
+
+struct Aabb {
+    float min[3];
+    float max[3];
+};
+
+// Inner nodes have count 0 and children first and first + 1; leaves hold
+// items[first .. first + count)
+struct BvhNode {
+    float min[3];
+    uint32_t first;
+    float max[3];
+    uint32_t count;
+};
+
+struct Bvh {
+    std::vector<BvhNode> nodes;  // Root first
+    std::vector<uint32_t> items; // Item (box) indices, grouped by leaf
+};
+
+// Ray from eye through the centre of window pixel (x, y), counted from the
+// top-left as GLUT reports it
+inline Ray screenRay(const Mat4& view, const Mat4& projection, const Vec3& eye,
+                     int x, int y, int width, int height) {
+    Mat4 clipToWorld = inverse(projection * view);
+    float ndcX = 2.0f * (x + 0.5f) / width - 1.0f;
+    float ndcY = 1.0f - 2.0f * (y + 0.5f) / height;
+    Vec4 farPoint = clipToWorld * Vec4{ndcX, ndcY, 1.0f, 1.0f};
+    Vec3 target = Vec3{farPoint.x, farPoint.y, farPoint.z} * (1.0f / farPoint.w);
+
+    Ray ray;
+    ray.origin = eye;
+    ray.direction = normalize(target - eye);
+    return ray;
+}
+
+inline Ray transformRay(const Mat4& m, const Ray& ray) {
+    Vec4 origin = m * Vec4{ray.origin.x, ray.origin.y, ray.origin.z, 1.0f};
+    Vec4 direction = m * Vec4{ray.direction.x, ray.direction.y, ray.direction.z, 0.0f};
+
+    Ray r;
+    r.origin = Vec3{origin.x, origin.y, origin.z};
+    r.direction = Vec3{direction.x, direction.y, direction.z};
+    return r;
+}
+
+// Box around the transformed box (Arvo: per axis, each matrix entry adds
+// its smaller or larger product with the box extent)
+inline Aabb transformAabb(const Mat4& m, const Aabb& box) {
+    Aabb r;
+    for (int row = 0; row < 3; row++) {
+        r.min[row] = r.max[row] = m.m[12 + row];
+        for (int col = 0; col < 3; col++) {
+            float a = m.m[col * 4 + row] * box.min[col];
+            float b = m.m[col * 4 + row] * box.max[col];
+            r.min[row] += std::min(a, b);
+            r.max[row] += std::max(a, b);
+        }
+    }
+    return r;
+}
+
+// Entry distance of the ray into [min, max] if it is below tMax
+inline bool rayHitsBox(const Vec3& origin, const float* inverseDirection, const float* min, const float* max,
+                       float tMax, float& tEntry) {
+    const float o[3] = {origin.x, origin.y, origin.z};
+    float tNear = 0.0f;
+    float tFar = tMax;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (min[axis] - o[axis]) * inverseDirection[axis];
+        float t1 = (max[axis] - o[axis]) * inverseDirection[axis];
+        tNear = std::max(tNear, std::min(t0, t1));
+        tFar = std::min(tFar, std::max(t0, t1));
+    }
+    tEntry = tNear;
+    return tNear <= tFar;
+}
+
+// Moller-Trumbore; t of a hit in (0, tMax), two-sided
+inline bool rayHitsTriangle(const Ray& ray, const float* a, const float* b, const float* c, float tMax, float& t) {
+    Vec3 p0 = Vec3{a[0], a[1], a[2]};
+    Vec3 edge1 = Vec3{b[0], b[1], b[2]} - p0;
+    Vec3 edge2 = Vec3{c[0], c[1], c[2]} - p0;
+    Vec3 p = cross(ray.direction, edge2);
+    float det = dot(edge1, p);
+    if (std::fabs(det) < 1e-12f) {
+        return false;
+    }
+    float inverseDet = 1.0f / det;
+    Vec3 s = ray.origin - p0;
+    float u = dot(s, p) * inverseDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    Vec3 q = cross(s, edge1);
+    float v = dot(ray.direction, q) * inverseDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    t = dot(edge2, q) * inverseDet;
+    return t > 0.0f && t < tMax;
+}
+
+inline void buildBvhNode(Bvh& bvh, const Aabb* boxes, const std::vector<float>& centroids,
+                         uint32_t node, uint32_t first, uint32_t count) {
+    float lo[3] = {INFINITY, INFINITY, INFINITY};
+    float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    float centroidLo[3] = {INFINITY, INFINITY, INFINITY};
+    float centroidHi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = first; i < first + count; i++) {
+        uint32_t item = bvh.items[i];
+        for (int axis = 0; axis < 3; axis++) {
+            lo[axis] = std::min(lo[axis], boxes[item].min[axis]);
+            hi[axis] = std::max(hi[axis], boxes[item].max[axis]);
+            centroidLo[axis] = std::min(centroidLo[axis], centroids[item * 3 + axis]);
+            centroidHi[axis] = std::max(centroidHi[axis], centroids[item * 3 + axis]);
+        }
+    }
+    for (int axis = 0; axis < 3; axis++) {
+        bvh.nodes[node].min[axis] = lo[axis];
+        bvh.nodes[node].max[axis] = hi[axis];
+    }
+
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (centroidHi[a] - centroidLo[a] > centroidHi[axis] - centroidLo[axis]) {
+            axis = a;
+        }
+    }
+    // Small enough, or every centroid in one point: nothing to split
+    if (count <= (uint32_t)BVH_LEAF_SIZE || centroidHi[axis] <= centroidLo[axis]) {
+        bvh.nodes[node].first = first;
+        bvh.nodes[node].count = count;
+        return;
+    }
+
+    uint32_t half = count / 2;
+    std::nth_element(bvh.items.begin() + first, bvh.items.begin() + first + half, bvh.items.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) { return centroids[a * 3 + axis] < centroids[b * 3 + axis]; });
+
+    uint32_t left = (uint32_t)bvh.nodes.size();
+    bvh.nodes.resize(left + 2);
+    bvh.nodes[node].first = left;
+    bvh.nodes[node].count = 0;
+    buildBvhNode(bvh, boxes, centroids, left, first, half);
+    buildBvhNode(bvh, boxes, centroids, left + 1, first + half, count - half);
+}
+
+inline void buildBvh(const Aabb* boxes, size_t count, Bvh& bvh) {
+    bvh.nodes.clear();
+    bvh.items.resize(count);
+    if (count == 0) {
+        return;
+    }
+    std::vector<float> centroids(count * 3);
+    for (size_t i = 0; i < count; i++) {
+        bvh.items[i] = (uint32_t)i;
+        for (int axis = 0; axis < 3; axis++) {
+            centroids[i * 3 + axis] = 0.5f * (boxes[i].min[axis] + boxes[i].max[axis]);
+        }
+    }
+    bvh.nodes.reserve(2 * (count / BVH_LEAF_SIZE + 1));
+    bvh.nodes.resize(1);
+    buildBvhNode(bvh, boxes, centroids, 0, 0, (uint32_t)count);
+}
+
+inline Aabb bvhBounds(const Bvh& bvh) {
+    Aabb box;
+    for (int axis = 0; axis < 3; axis++) {
+        box.min[axis] = bvh.nodes.empty() ? 0.0f : bvh.nodes[0].min[axis];
+        box.max[axis] = bvh.nodes.empty() ? 0.0f : bvh.nodes[0].max[axis];
+    }
+    return box;
+}
+
+// Call visit(item, tMax) for every item whose box the ray enters before
+// tMax, nearest boxes first. visit lowers tMax when it finds a hit, which
+// skips everything behind it.
+template <typename Visit>
+void traverseBvh(const Bvh& bvh, const Ray& ray, float& tMax, Visit visit) {
+    if (bvh.nodes.empty()) {
+        return;
+    }
+    const float inverseDirection[3] = {1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z};
+
+    struct Entry {
+        uint32_t node;
+        float t;
+    };
+    Entry stack[64];
+    int top = 0;
+    float t;
+    if (rayHitsBox(ray.origin, inverseDirection, bvh.nodes[0].min, bvh.nodes[0].max, tMax, t)) {
+        stack[top++] = Entry{0, t};
+    }
+    while (top > 0) {
+        Entry entry = stack[--top];
+        if (entry.t > tMax) {
+            continue;
+        }
+        const BvhNode& node = bvh.nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                visit(bvh.items[i], tMax);
+            }
+            continue;
+        }
+
+        // Push the farther child first so the nearer one is visited next
+        const BvhNode& left = bvh.nodes[node.first];
+        const BvhNode& right = bvh.nodes[node.first + 1];
+        float tLeft, tRight;
+        bool hitLeft = rayHitsBox(ray.origin, inverseDirection, left.min, left.max, tMax, tLeft);
+        bool hitRight = rayHitsBox(ray.origin, inverseDirection, right.min, right.max, tMax, tRight);
+        if (hitLeft && hitRight) {
+            bool leftFirst = tLeft <= tRight;
+            stack[top++] = leftFirst ? Entry{node.first + 1, tRight} : Entry{node.first, tLeft};
+            stack[top++] = leftFirst ? Entry{node.first, tLeft} : Entry{node.first + 1, tRight};
+        } else if (hitLeft) {
+            stack[top++] = Entry{node.first, tLeft};
+        } else if (hitRight) {
+            stack[top++] = Entry{node.first + 1, tRight};
+        }
+    }
+}
+
+// Triangle t is indices[3t .. 3t + 2], in the order the mesh is drawn, so
+// it matches gl_PrimitiveID
+struct BvhMesh {
+    std::vector<float> positions;  // xyz per vertex
+    std::vector<uint32_t> indices;
+    Bvh bvh;
+};
+
+// Copy positions (first 3 of `stride` floats) and indices, and build the
+// triangle Bvh
+template <typename Index>
+void buildBvhMesh(const float* vertices, size_t vertexCount, int stride,
+                  const Index* indices, size_t indexCount, BvhMesh& mesh) {
+    mesh.positions.resize(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; v++) {
+        for (int c = 0; c < 3; c++) {
+            mesh.positions[v * 3 + c] = vertices[v * stride + c];
+        }
+    }
+    mesh.indices.assign(indices, indices + indexCount);
+
+    size_t triangleCount = indexCount / 3;
+    std::vector<Aabb> boxes(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int axis = 0; axis < 3; axis++) {
+            boxes[t].min[axis] = INFINITY;
+            boxes[t].max[axis] = -INFINITY;
+            for (int k = 0; k < 3; k++) {
+                float p = mesh.positions[mesh.indices[t * 3 + k] * 3 + axis];
+                boxes[t].min[axis] = std::min(boxes[t].min[axis], p);
+                boxes[t].max[axis] = std::max(boxes[t].max[axis], p);
+            }
+        }
+    }
+    buildBvh(boxes.data(), triangleCount, mesh.bvh);
+}
+
+// Nearest triangle the ray hits before tMax; lowers tMax to its t
+inline bool intersectBvhMesh(const BvhMesh& mesh, const Ray& ray, float& tMax, uint32_t& triangle) {
+    bool hit = false;
+    traverseBvh(mesh.bvh, ray, tMax, [&](uint32_t t, float& limit) {
+        const uint32_t* index = &mesh.indices[t * 3];
+        float distance;
+        if (rayHitsTriangle(ray, &mesh.positions[index[0] * 3], &mesh.positions[index[1] * 3],
+                            &mesh.positions[index[2] * 3], limit, distance)) {
+            limit = distance;
+            triangle = t;
+            hit = true;
+        }
+    });
+    return hit;
+}
+
+#endif
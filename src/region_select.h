@@ -0,0 +1,142 @@
+// Region selection over a read-back id buffer: the objects that appear in a
+// rectangle or lasso, found in one pass over the region's pixels.
+//  - rasterizeLasso: even-odd fill of a polygon into a pixel mask
+//  - selectRegion: rows split across the shared thread pool, each range
+//    marking the ids it sees in its own flag array (runs of one id cost a
+//    compare per pixel), then the arrays are OR-ed and scanned in id order
+// With fullyVisibleOnly an object is dropped when any of its pixels lies
+// on the region border (it continues outside) or next to a nearer object
+// (it is partly hidden); for convex objects that is exact.
+// (CPU only, no OpenGL calls.)
+#ifndef REGION_SELECT_H
+#define REGION_SELECT_H
+
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+#include "thread_pool.h"
+
+// Per-object flags of selectRegion
+const uint8_t REGION_SEEN = 1;
+const uint8_t REGION_PARTIAL = 2;  // Crosses the border or is partly hidden
+
+// Fill mask (width x height, row-major) with 1 for pixels whose centre lies
+// inside the polygon, 0 elsewhere. points holds x, y pairs in the mask's
+// pixel units (pixel (i, j) has its centre at (i + 0.5, j + 0.5)).
+inline void rasterizeLasso(const std::vector<float>& points, int width, int height, std::vector<uint8_t>& mask) {
+    mask.assign((size_t)width * height, 0);
+    size_t count = points.size() / 2;
+    if (count < 3) {
+        return;
+    }
+    std::vector<float> crossings;
+    for (int row = 0; row < height; row++) {
+        float y = row + 0.5f;
+        crossings.clear();
+        for (size_t i = 0; i < count; i++) {
+            size_t j = (i + 1) % count;
+            float x0 = points[i * 2], y0 = points[i * 2 + 1];
+            float x1 = points[j * 2], y1 = points[j * 2 + 1];
+            // Half-open in y, so a vertex on the scanline counts once
+            if ((y0 <= y) != (y1 <= y)) {
+                crossings.push_back(x0 + (y - y0) / (y1 - y0) * (x1 - x0));
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+        uint8_t* line = &mask[(size_t)row * width];
+        for (size_t c = 0; c + 1 < crossings.size(); c += 2) {
+            // Pixels with crossings[c] <= centre < crossings[c + 1]
+            int first = std::max(0, (int)std::ceil(crossings[c] - 0.5f));
+            int last = std::min(width, (int)std::ceil(crossings[c + 1] - 0.5f));
+            for (int x = first; x < last; x++) {
+                line[x] = 1;
+            }
+        }
+    }
+}
+
+// Mark the objects in rows [rowBegin, rowEnd) of the region into flags.
+// ids are (object id + 1, triangle) pairs, 0 for background.
+inline void markRegionRows(const uint32_t* ids, const float* depths, const uint8_t* mask, int width, int height,
+                           size_t objectCount, bool fullyVisibleOnly, int rowBegin, int rowEnd, uint8_t* flags) {
+    for (int row = rowBegin; row < rowEnd; row++) {
+        uint32_t previous = 0;
+        for (int x = 0; x < width; x++) {
+            size_t p = (size_t)row * width + x;
+            uint32_t id = ids[p * 2];
+            if (mask && !mask[p]) {
+                previous = 0;
+                continue;
+            }
+            if (id == 0 || id > objectCount) {
+                previous = 0;
+                continue;
+            }
+            if (!fullyVisibleOnly) {
+                if (id != previous) {
+                    flags[id - 1] |= REGION_SEEN;
+                    previous = id;
+                }
+                continue;
+            }
+
+            uint8_t flag = REGION_SEEN;
+            const int dx[4] = {-1, 1, 0, 0};
+            const int dy[4] = {0, 0, -1, 1};
+            for (int n = 0; n < 4; n++) {
+                int nx = x + dx[n];
+                int ny = row + dy[n];
+                if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+                    flag |= REGION_PARTIAL;
+                    continue;
+                }
+                size_t q = (size_t)ny * width + nx;
+                if (mask && !mask[q]) {
+                    flag |= REGION_PARTIAL;
+                }
+                uint32_t other = ids[q * 2];
+                if (other != 0 && other != id && depths[q] < depths[p]) {
+                    flag |= REGION_PARTIAL;
+                }
+            }
+            flags[id - 1] |= flag;
+        }
+    }
+}
+
+// Ids of the objects in a width x height region of the id buffer, in
+// ascending order. depths (window depth per pixel) is only read with
+// fullyVisibleOnly; mask (1 inside) may be null for the whole rectangle.
+inline void selectRegion(const uint32_t* ids, const float* depths, const uint8_t* mask, int width, int height,
+                         size_t objectCount, bool fullyVisibleOnly, int threads, std::vector<uint32_t>& selected) {
+    selected.clear();
+    if (width <= 0 || height <= 0 || objectCount == 0) {
+        return;
+    }
+    // A few dozen rows per thread at least, so small regions stay serial
+    threads = std::max(1, std::min(threads, height / 32));
+
+    // Each range marks its own flags, then ORs them into merged
+    std::vector<uint8_t> merged(objectCount, 0);
+    std::mutex mergeMutex;
+    parallelRanges(height, threads, [&](int rowBegin, int rowEnd) {
+        std::vector<uint8_t> flags(objectCount, 0);
+        markRegionRows(ids, depths, mask, width, height, objectCount, fullyVisibleOnly, rowBegin, rowEnd,
+                       flags.data());
+        std::lock_guard<std::mutex> lock(mergeMutex);
+        for (size_t i = 0; i < objectCount; i++) {
+            merged[i] |= flags[i];
+        }
+    });
+
+    for (size_t i = 0; i < objectCount; i++) {
+        if (merged[i] == REGION_SEEN || (merged[i] && !fullyVisibleOnly)) {
+            selected.push_back((uint32_t)i);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,179 @@
+// Linked GLSL program with its uniform locations resolved once at link time,
+// plus the per-frame uniform block shared by the Phong shaders.
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <GL/glew.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+
+// Camera and light data for one frame, laid out as the std140 block
+//
+//   layout(std140) uniform FrameData {
+//       mat4 view;
+//       mat4 projection;
+//       vec4 lightPos;
+//       vec4 viewPos;
+//       vec4 lightColor;
+//   };
+//
+// which every Phong shader declares. vec3 values are padded to vec4.
+struct FrameUniforms {
+    float view[16];
+    float projection[16];
+    float lightPos[4];
+    float viewPos[4];
+    float lightColor[4];
+};
+
+const unsigned int FRAME_UNIFORM_BINDING = 0;
+
+// Uniform buffer holding FrameUniforms, bound to FRAME_UNIFORM_BINDING
+struct FrameUniformBuffer {
+    unsigned int buffer = 0;
+
+    void create() {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    void update(const FrameUniforms& frame) {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+// A linked program. location() is meant for init code: it reads a table
+// built at link time and never calls into the driver. The set* calls keep
+// the last value written to each location and skip unchanged uploads, so
+// per-object material state costs nothing when it repeats.
+struct ShaderProgram {
+    unsigned int id = 0;
+    std::unordered_map<std::string, int> locations;
+    std::unordered_map<int, std::vector<float> > values;
+
+    // Link the stages, report errors, bind the FrameData block if the
+    // program uses it and record every active uniform's location
+    bool link(const std::vector<unsigned int>& shaders) {
+        id = glCreateProgram();
+        for (size_t i = 0; i < shaders.size(); i++) {
+            glAttachShader(id, shaders[i]);
+        }
+        glLinkProgram(id);
+
+        int success;
+        glGetProgramiv(id, GL_LINK_STATUS, &success);
+        if (!success) {
+            char infoLog[512];
+            glGetProgramInfoLog(id, 512, nullptr, infoLog);
+            std::cerr << "Shader program linking failed: " << infoLog << std::endl;
+            return false;
+        }
+
+        unsigned int block = glGetUniformBlockIndex(id, "FrameData");
+        if (block != GL_INVALID_INDEX) {
+            glUniformBlockBinding(id, block, FRAME_UNIFORM_BINDING);
+        }
+
+        int count = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        for (int i = 0; i < count; i++) {
+            char name[128];
+            int size;
+            GLenum type;
+            glGetActiveUniform(id, i, sizeof(name), nullptr, &size, &type, name);
+            int location = glGetUniformLocation(id, name);
+            if (location >= 0) {
+                locations[name] = location;
+            }
+        }
+        return true;
+    }
+
+    bool link(unsigned int vertexShader, unsigned int fragmentShader) {
+        std::vector<unsigned int> shaders;
+        shaders.push_back(vertexShader);
+        shaders.push_back(fragmentShader);
+        return link(shaders);
+    }
+
+    int location(const char* name) const {
+        std::unordered_map<std::string, int>::const_iterator it = locations.find(name);
+        if (it == locations.end()) {
+            std::cerr << "Uniform not active in program: " << name << std::endl;
+            return -1;
+        }
+        return it->second;
+    }
+
+    void use() const {
+        glUseProgram(id);
+    }
+
+    // True if location already holds these values; otherwise records them
+    bool unchanged(int location, const float* data, int count) {
+        std::vector<float>& cached = values[location];
+        if ((int)cached.size() == count && memcmp(cached.data(), data, count * sizeof(float)) == 0) {
+            return true;
+        }
+        cached.assign(data, data + count);
+        return false;
+    }
+
+    void setFloat(int location, float value) {
+        if (location >= 0 && !unchanged(location, &value, 1)) {
+            glUniform1f(location, value);
+        }
+    }
+
+    void setVec2(int location, float x, float y) {
+        float value[2] = {x, y};
+        if (location >= 0 && !unchanged(location, value, 2)) {
+            glUniform2f(location, x, y);
+        }
+    }
+
+    void setVec3(int location, float x, float y, float z) {
+        float value[3] = {x, y, z};
+        if (location >= 0 && !unchanged(location, value, 3)) {
+            glUniform3f(location, x, y, z);
+        }
+    }
+
+    void setInt(int location, int value) {
+        float asFloat = (float)value;
+        if (location >= 0 && !unchanged(location, &asFloat, 1)) {
+            glUniform1i(location, value);
+        }
+    }
+
+    void setMat4(int location, const float* matrix) {
+        if (location >= 0 && !unchanged(location, matrix, 16)) {
+            glUniformMatrix4fv(location, 1, GL_FALSE, matrix);
+        }
+    }
+};
+
+// Fill the frame block from column-major matrices and xyz positions
+inline void setFrameUniforms(FrameUniforms& frame, const float* view, const float* projection,
+                             const float* lightPos, const float* viewPos, const float* lightColor) {
+    memcpy(frame.view, view, sizeof(frame.view));
+    memcpy(frame.projection, projection, sizeof(frame.projection));
+    for (int i = 0; i < 3; i++) {
+        frame.lightPos[i] = lightPos[i];
+        frame.viewPos[i] = viewPos[i];
+        frame.lightColor[i] = lightColor[i];
+    }
+    frame.lightPos[3] = 1.0f;
+    frame.viewPos[3] = 1.0f;
+    frame.lightColor[3] = 1.0f;
+}
+
+#endif
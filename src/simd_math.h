@@ -0,0 +1,444 @@
+// Vector and 4x4 matrix math shared by the OpenGL programs.
+//
+// Matrices are column-major, m[col * 4 + row], which is what
+// glUniformMatrix4fv expects with transpose = GL_FALSE. Vectors are column
+// vectors: p' = M * p, and A * B applies B first.
+//
+// 4x4 products and transforms use SSE on x86-64 (always available there);
+// the batch kernels switch to AVX at runtime when the CPU has it. Every path
+// does the same multiplies and adds in the same order, so results are
+// bit-identical to the scalar fallback.
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SIMD_MATH_X86 1
+#endif
+
+// Padded to 16 bytes so arrays of points load with aligned SSE moves
+struct alignas(16) Vec3 {
+    float x, y, z;
+};
+
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+};
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) {
+    return Vec3{a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline Vec3 operator-(const Vec3& a, const Vec3& b) {
+    return Vec3{a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline Vec3 operator*(const Vec3& a, float s) {
+    return Vec3{a.x * s, a.y * s, a.z * s};
+}
+
+inline float dot(const Vec3& a, const Vec3& b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3& a, const Vec3& b) {
+    return Vec3{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline float length(const Vec3& a) {
+    return sqrt(dot(a, a));
+}
+
+// Unit vector; near-zero vectors are returned unchanged
+inline Vec3 normalize(const Vec3& a) {
+    float len = length(a);
+    return len > 1e-6f ? a * (1.0f / len) : a;
+}
+
+struct alignas(16) Mat4 {
+    float m[16];
+
+    static Mat4 identity() {
+        Mat4 r;
+        for (int i = 0; i < 16; i++) {
+            r.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+        }
+        return r;
+    }
+
+    static Mat4 translation(float x, float y, float z) {
+        Mat4 r = identity();
+        r.m[12] = x;
+        r.m[13] = y;
+        r.m[14] = z;
+        return r;
+    }
+
+    static Mat4 scale(float x, float y, float z) {
+        Mat4 r = identity();
+        r.m[0] = x;
+        r.m[5] = y;
+        r.m[10] = z;
+        return r;
+    }
+
+    // Right-handed rotations by angle degrees about each axis
+    static Mat4 rotationX(float degrees) {
+        float c = cos(degrees * M_PI / 180.0f);
+        float s = sin(degrees * M_PI / 180.0f);
+        Mat4 r = identity();
+        r.m[5] = c;
+        r.m[6] = s;
+        r.m[9] = -s;
+        r.m[10] = c;
+        return r;
+    }
+
+    static Mat4 rotationY(float degrees) {
+        float c = cos(degrees * M_PI / 180.0f);
+        float s = sin(degrees * M_PI / 180.0f);
+        Mat4 r = identity();
+        r.m[0] = c;
+        r.m[2] = -s;
+        r.m[8] = s;
+        r.m[10] = c;
+        return r;
+    }
+
+    static Mat4 rotationZ(float degrees) {
+        float c = cos(degrees * M_PI / 180.0f);
+        float s = sin(degrees * M_PI / 180.0f);
+        Mat4 r = identity();
+        r.m[0] = c;
+        r.m[1] = s;
+        r.m[4] = -s;
+        r.m[5] = c;
+        return r;
+    }
+
+    // View matrix looking from eye towards center (gluLookAt)
+    static Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& up) {
+        Vec3 f = normalize(center - eye);
+        Vec3 s = normalize(cross(f, up));
+        Vec3 u = cross(s, f);
+
+        Mat4 r = identity();
+        r.m[0] = s.x; r.m[4] = s.y; r.m[8] = s.z;
+        r.m[1] = u.x; r.m[5] = u.y; r.m[9] = u.z;
+        r.m[2] = -f.x; r.m[6] = -f.y; r.m[10] = -f.z;
+        r.m[12] = -dot(s, eye);
+        r.m[13] = -dot(u, eye);
+        r.m[14] = dot(f, eye);
+        return r;
+    }
+
+    // Projection with a vertical field of view in degrees (gluPerspective)
+    static Mat4 perspective(float fovy, float aspect, float near, float far) {
+        float f = 1.0f / tan(fovy * M_PI / 360.0f);
+        Mat4 r = identity();
+        r.m[0] = f / aspect;
+        r.m[5] = f;
+        r.m[10] = (far + near) / (near - far);
+        r.m[11] = -1.0f;
+        r.m[14] = (2.0f * far * near) / (near - far);
+        r.m[15] = 0.0f;
+        return r;
+    }
+};
+
+// Scalar reference kernels, also the fallback on other architectures
+
+inline void multiplyMat4Scalar(const Mat4& a, const Mat4& b, Mat4& out) {
+    Mat4 r;
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            r.m[col * 4 + row] = ((a.m[row] * b.m[col * 4 + 0] + a.m[4 + row] * b.m[col * 4 + 1]) +
+                                  a.m[8 + row] * b.m[col * 4 + 2]) + a.m[12 + row] * b.m[col * 4 + 3];
+        }
+    }
+    out = r;
+}
+
+inline Vec4 transformVec4Scalar(const Mat4& a, const Vec4& v) {
+    float r[4];
+    for (int row = 0; row < 4; row++) {
+        r[row] = ((a.m[row] * v.x + a.m[4 + row] * v.y) + a.m[8 + row] * v.z) + a.m[12 + row] * v.w;
+    }
+    return Vec4{r[0], r[1], r[2], r[3]};
+}
+
+// Gauss-Jordan elimination with partial pivoting; false if singular
+inline bool inverseScalar(const Mat4& a, Mat4& out) {
+    float w[4][8];
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            w[row][col] = a.m[col * 4 + row];
+            w[row][col + 4] = (row == col) ? 1.0f : 0.0f;
+        }
+    }
+    for (int col = 0; col < 4; col++) {
+        int pivot = col;
+        for (int row = col + 1; row < 4; row++) {
+            if (fabs(w[row][col]) > fabs(w[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (fabs(w[pivot][col]) < 1e-12f) {
+            return false;
+        }
+        for (int k = 0; k < 8; k++) {
+            float t = w[col][k];
+            w[col][k] = w[pivot][k];
+            w[pivot][k] = t;
+        }
+        float scale = 1.0f / w[col][col];
+        for (int k = 0; k < 8; k++) {
+            w[col][k] *= scale;
+        }
+        for (int row = 0; row < 4; row++) {
+            if (row != col) {
+                float factor = w[row][col];
+                for (int k = 0; k < 8; k++) {
+                    w[row][k] -= factor * w[col][k];
+                }
+            }
+        }
+    }
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            out.m[col * 4 + row] = w[row][col + 4];
+        }
+    }
+    return true;
+}
+
+#ifdef SIMD_MATH_X86
+
+// a * (x, y, z, w) with a's columns in registers
+inline __m128 transformColumnSSE(const __m128* a, __m128 v) {
+    __m128 r = _mm_mul_ps(a[0], _mm_shuffle_ps(v, v, 0x00));
+    r = _mm_add_ps(r, _mm_mul_ps(a[1], _mm_shuffle_ps(v, v, 0x55)));
+    r = _mm_add_ps(r, _mm_mul_ps(a[2], _mm_shuffle_ps(v, v, 0xAA)));
+    return _mm_add_ps(r, _mm_mul_ps(a[3], _mm_shuffle_ps(v, v, 0xFF)));
+}
+
+inline void multiplyMat4SSE(const Mat4& a, const Mat4& b, Mat4& out) {
+    __m128 columns[4] = {_mm_load_ps(a.m), _mm_load_ps(a.m + 4), _mm_load_ps(a.m + 8), _mm_load_ps(a.m + 12)};
+    __m128 r0 = transformColumnSSE(columns, _mm_load_ps(b.m));
+    __m128 r1 = transformColumnSSE(columns, _mm_load_ps(b.m + 4));
+    __m128 r2 = transformColumnSSE(columns, _mm_load_ps(b.m + 8));
+    __m128 r3 = transformColumnSSE(columns, _mm_load_ps(b.m + 12));
+    _mm_store_ps(out.m, r0);
+    _mm_store_ps(out.m + 4, r1);
+    _mm_store_ps(out.m + 8, r2);
+    _mm_store_ps(out.m + 12, r3);
+}
+
+// 2x2 blocks packed as (m00, m01, m10, m11)
+inline __m128 mat2Mul(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+                      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                                 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adj(a) * b
+inline __m128 mat2AdjMul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+                      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)),
+                                 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// a * adj(b)
+inline __m128 mat2MulAdj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+                      _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                                 _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// Block-wise inverse over the four 2x2 sub-matrices. The algebra is the
+// same for rows or columns, since inverse(transpose(M)) = transpose(inverse(M)).
+inline void inverseSSE(const Mat4& in, Mat4& out) {
+    __m128 c0 = _mm_load_ps(in.m);
+    __m128 c1 = _mm_load_ps(in.m + 4);
+    __m128 c2 = _mm_load_ps(in.m + 8);
+    __m128 c3 = _mm_load_ps(in.m + 12);
+
+    __m128 A = _mm_movelh_ps(c0, c1);
+    __m128 B = _mm_movehl_ps(c1, c0);
+    __m128 C = _mm_movelh_ps(c2, c3);
+    __m128 D = _mm_movehl_ps(c3, c2);
+
+    // (|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(c0, c2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(c1, c3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 detA = _mm_shuffle_ps(detSub, detSub, 0x00);
+    __m128 detB = _mm_shuffle_ps(detSub, detSub, 0x55);
+    __m128 detC = _mm_shuffle_ps(detSub, detSub, 0xAA);
+    __m128 detD = _mm_shuffle_ps(detSub, detSub, 0xFF);
+
+    __m128 DC = mat2AdjMul(D, C);
+    __m128 AB = mat2AdjMul(A, B);
+    __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, DC));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, AB));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, AB));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, DC));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(AB, _mm_shuffle_ps(DC, DC, _MM_SHUFFLE(3, 1, 2, 0)));
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+    tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+    __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    X = _mm_mul_ps(X, rDetM);
+    Y = _mm_mul_ps(Y, rDetM);
+    Z = _mm_mul_ps(Z, rDetM);
+    W = _mm_mul_ps(W, rDetM);
+
+    _mm_store_ps(out.m, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(out.m + 4, _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_store_ps(out.m + 8, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_store_ps(out.m + 12, _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2)));
+}
+
+// AVX: two columns (or two Vec4s) per 256-bit register, with a's columns
+// broadcast to both halves
+__attribute__((target("avx")))
+inline __m256 transformPairAVX(const __m256* a, __m256 v) {
+    __m256 r = _mm256_mul_ps(a[0], _mm256_permute_ps(v, 0x00));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a[1], _mm256_permute_ps(v, 0x55)));
+    r = _mm256_add_ps(r, _mm256_mul_ps(a[2], _mm256_permute_ps(v, 0xAA)));
+    return _mm256_add_ps(r, _mm256_mul_ps(a[3], _mm256_permute_ps(v, 0xFF)));
+}
+
+__attribute__((target("avx")))
+inline void multiplyMat4BatchAVX(const Mat4* a, const Mat4* b, Mat4* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        __m256 columns[4] = {_mm256_broadcast_ps((const __m128*)a[i].m),
+                             _mm256_broadcast_ps((const __m128*)(a[i].m + 4)),
+                             _mm256_broadcast_ps((const __m128*)(a[i].m + 8)),
+                             _mm256_broadcast_ps((const __m128*)(a[i].m + 12))};
+        __m256 r01 = transformPairAVX(columns, _mm256_loadu_ps(b[i].m));
+        __m256 r23 = transformPairAVX(columns, _mm256_loadu_ps(b[i].m + 8));
+        _mm256_storeu_ps(out[i].m, r01);
+        _mm256_storeu_ps(out[i].m + 8, r23);
+    }
+}
+
+__attribute__((target("avx")))
+inline void transformVec4BatchAVX(const Mat4& a, const Vec4* in, Vec4* out, size_t count) {
+    __m256 columns[4] = {_mm256_broadcast_ps((const __m128*)a.m), _mm256_broadcast_ps((const __m128*)(a.m + 4)),
+                         _mm256_broadcast_ps((const __m128*)(a.m + 8)), _mm256_broadcast_ps((const __m128*)(a.m + 12))};
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        _mm256_storeu_ps(&out[i].x, transformPairAVX(columns, _mm256_loadu_ps(&in[i].x)));
+    }
+    if (i < count) {
+        __m128 half[4] = {_mm256_castps256_ps128(columns[0]), _mm256_castps256_ps128(columns[1]),
+                          _mm256_castps256_ps128(columns[2]), _mm256_castps256_ps128(columns[3])};
+        _mm_store_ps(&out[i].x, transformColumnSSE(half, _mm_load_ps(&in[i].x)));
+    }
+}
+
+inline bool simdMathHasAVX() {
+    static const bool hasAVX = __builtin_cpu_supports("avx");
+    return hasAVX;
+}
+
+#endif
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+#ifdef SIMD_MATH_X86
+    multiplyMat4SSE(a, b, r);
+#else
+    multiplyMat4Scalar(a, b, r);
+#endif
+    return r;
+}
+
+inline Vec4 operator*(const Mat4& a, const Vec4& v) {
+#ifdef SIMD_MATH_X86
+    __m128 columns[4] = {_mm_load_ps(a.m), _mm_load_ps(a.m + 4), _mm_load_ps(a.m + 8), _mm_load_ps(a.m + 12)};
+    Vec4 r;
+    _mm_store_ps(&r.x, transformColumnSSE(columns, _mm_load_ps(&v.x)));
+    return r;
+#else
+    return transformVec4Scalar(a, v);
+#endif
+}
+
+// Inverse of an invertible matrix (a singular one gives inf/NaN entries on
+// the SIMD path; use inverseScalar to detect that case)
+inline Mat4 inverse(const Mat4& a) {
+    Mat4 r;
+#ifdef SIMD_MATH_X86
+    inverseSSE(a, r);
+#else
+    inverseScalar(a, r);
+#endif
+    return r;
+}
+
+inline Mat4 transpose(const Mat4& a) {
+    Mat4 r;
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            r.m[row * 4 + col] = a.m[col * 4 + row];
+        }
+    }
+    return r;
+}
+
+// out[i] = a[i] * b[i]
+inline void multiplyMat4Batch(const Mat4* a, const Mat4* b, Mat4* out, size_t count) {
+#ifdef SIMD_MATH_X86
+    if (simdMathHasAVX()) {
+        multiplyMat4BatchAVX(a, b, out, count);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a[i] * b[i];
+    }
+}
+
+// out[i] = a * in[i]
+inline void transformVec4Batch(const Mat4& a, const Vec4* in, Vec4* out, size_t count) {
+#ifdef SIMD_MATH_X86
+    if (simdMathHasAVX()) {
+        transformVec4BatchAVX(a, in, out, count);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        out[i] = a * in[i];
+    }
+}
+
+// Points (w = 1) through an affine matrix; no perspective divide
+inline void transformPoints(const Mat4& a, const Vec3* in, Vec3* out, size_t count) {
+#ifdef SIMD_MATH_X86
+    __m128 c0 = _mm_load_ps(a.m);
+    __m128 c1 = _mm_load_ps(a.m + 4);
+    __m128 c2 = _mm_load_ps(a.m + 8);
+    __m128 c3 = _mm_load_ps(a.m + 12);
+    for (size_t i = 0; i < count; i++) {
+        __m128 p = _mm_load_ps(&in[i].x);
+        __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_shuffle_ps(p, p, 0x00)), _mm_mul_ps(c1, _mm_shuffle_ps(p, p, 0x55)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(p, p, 0xAA)));
+        _mm_store_ps(&out[i].x, _mm_add_ps(r, c3));
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        Vec4 r = transformVec4Scalar(a, Vec4{in[i].x, in[i].y, in[i].z, 1.0f});
+        out[i] = Vec3{r.x, r.y, r.z};
+    }
+#endif
+}
+
+#endif
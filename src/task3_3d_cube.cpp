@@ -3,6 +3,7 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include "simd_math.h"
 
 // Transformation types
 enum TransformationType {
@@ -26,11 +27,8 @@ float scaleDelta = 0.1f;
 float rotateDelta = 10.0f; // degrees
 float translateDelta = 0.1f;
 
-// Transformation matrices
-float scaleMatrix[16];
-float rotateXMatrix[16], rotateYMatrix[16], rotateZMatrix[16];
-float translateMatrix[16];
-float finalMatrix[16];
+// Transformation matrix
+Mat4 finalMatrix = Mat4::identity();
 
 // Shader source code
 const char* vertexShaderSource = R"(
@@ -60,95 +58,13 @@ void main()
 }
 )";
 
-// Matrix operations
-void createIdentityMatrix(float* matrix) {
-    for (int i = 0; i < 16; i++) {
-        matrix[i] = (i % 5 == 0) ? 1.0f : 0.0f;
-    }
-}
-
-void createScaleMatrix(float sx, float sy, float sz, float* matrix) {
-    createIdentityMatrix(matrix);
-    matrix[0] = sx;   // X scale
-    matrix[5] = sy;   // Y scale
-    matrix[10] = sz;  // Z scale
-}
-
-void createRotationXMatrix(float angle, float* matrix) {
-    createIdentityMatrix(matrix);
-    float c = cos(angle * M_PI / 180.0f);
-    float s = sin(angle * M_PI / 180.0f);
-    matrix[5] = c;
-    matrix[6] = -s;
-    matrix[9] = s;
-    matrix[10] = c;
-}
-
-void createRotationYMatrix(float angle, float* matrix) {
-    createIdentityMatrix(matrix);
-    float c = cos(angle * M_PI / 180.0f);
-    float s = sin(angle * M_PI / 180.0f);
-    matrix[0] = c;
-    matrix[2] = s;
-    matrix[8] = -s;
-    matrix[10] = c;
-}
-
-void createRotationZMatrix(float angle, float* matrix) {
-    createIdentityMatrix(matrix);
-    float c = cos(angle * M_PI / 180.0f);
-    float s = sin(angle * M_PI / 180.0f);
-    matrix[0] = c;
-    matrix[1] = -s;
-    matrix[4] = s;
-    matrix[5] = c;
-}
-
-void createTranslationMatrix(float tx, float ty, float tz, float* matrix) {
-    createIdentityMatrix(matrix);
-    matrix[12] = tx;  // X translation
-    matrix[13] = ty;  // Y translation
-    matrix[14] = tz;  // Z translation
-}
-
-void multiplyMatrices(const float* a, const float* b, float* result) {
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            result[i * 4 + j] = 0.0f;
-            for (int k = 0; k < 4; k++) {
-                result[i * 4 + j] += a[i * 4 + k] * b[k * 4 + j];
-            }
-        }
-    }
-}
-
 void updateTransformationMatrix() {
-    // Create individual transformation matrices
-    createScaleMatrix(scaleX, scaleY, scaleZ, scaleMatrix);
-    createRotationXMatrix(rotateX, rotateXMatrix);
-    createRotationYMatrix(rotateY, rotateYMatrix);
-    createRotationZMatrix(rotateZ, rotateZMatrix);
-    createTranslationMatrix(translateX, translateY, translateZ, translateMatrix);
-    
-    // Apply transformations in order: Scale -> Rotation -> Translation
-    float tempMatrix[16];
-    
-    // First: Scale
-    createIdentityMatrix(finalMatrix);
-    multiplyMatrices(finalMatrix, scaleMatrix, tempMatrix);
-    
-    // Second: Rotation (X, Y, Z)
-    multiplyMatrices(tempMatrix, rotateXMatrix, finalMatrix);
-    multiplyMatrices(finalMatrix, rotateYMatrix, tempMatrix);
-    multiplyMatrices(tempMatrix, rotateZMatrix, finalMatrix);
-    
-    // Third: Translation
-    multiplyMatrices(finalMatrix, translateMatrix, tempMatrix);
-    
-    // Copy final result
-    for (int i = 0; i < 16; i++) {
-        finalMatrix[i] = tempMatrix[i];
-    }
+    // Apply transformations in order: Scale -> Rotation (X, Y, Z) -> Translation.
+    // Angles are negated to keep the original turning direction per key (the
+    // old hand-written rotation matrices were uploaded transposed).
+    finalMatrix = Mat4::translation(translateX, translateY, translateZ) *
+                  Mat4::rotationZ(-rotateZ) * Mat4::rotationY(-rotateY) * Mat4::rotationX(-rotateX) *
+                  Mat4::scale(scaleX, scaleY, scaleZ);
 }
 
 void createCube() {
@@ -354,7 +270,7 @@ void display() {
     
     // Set transformation matrix uniform
     int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, finalMatrix);
+    glUniformMatrix4fv(transformLoc, 1, GL_FALSE, finalMatrix.m);
     
     // Draw cube
     glBindVertexArray(cubeVAO);
@@ -0,0 +1,149 @@
+// Persistent worker pool shared by the CPU-side generators (tessellation,
+// parametric meshes, region selection, procedural textures), so each call
+// wakes parked threads instead of creating new ones.
+//  - parallelRanges(count, threads, fn): run fn(begin, end) over [0, count)
+//    split into at most `threads` contiguous ranges, the calling thread
+//    taking the first
+// The pool is not reentrant: fn must not call parallelRanges itself, and
+// calls come from one thread at a time (the GLUT main thread).
+// (CPU only, no OpenGL calls.)
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+
+// The calling thread takes band 0, so a pool of size N runs N - 1 extra
+// threads.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threadCount) {
+        for (int w = 1; w < threadCount; w++) {
+            workers.push_back(std::thread(&ThreadPool::workerLoop, this, w));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t w = 0; w < workers.size(); w++) {
+            workers[w].join();
+        }
+    }
+
+    int size() const {
+        return (int)workers.size() + 1;
+    }
+
+    // Split [0, count) into `bands` contiguous bands (at most one per
+    // thread) and run fn(begin, end) on each; returns when every band has
+    // finished
+    void parallelFor(int count, int bands, const std::function<void(int, int)>& fn) {
+        bands = std::max(1, std::min(std::min(bands, count), size()));
+        if (bands < 2) {
+            fn(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            task = &fn;
+            taskCount = count;
+            taskBands = bands;
+            pending = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        int begin, end;
+        bandRange(0, begin, end);
+        fn(begin, end);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+        task = nullptr;
+    }
+
+private:
+    // Bands past taskBands are empty
+    void bandRange(int band, int& begin, int& end) const {
+        if (band >= taskBands) {
+            begin = end = taskCount;
+            return;
+        }
+        begin = (int)((long long)taskCount * band / taskBands);
+        end = (int)((long long)taskCount * (band + 1) / taskBands);
+    }
+
+    void workerLoop(int band) {
+        unsigned long seen = 0;
+        for (;;) {
+            const std::function<void(int, int)>* fn;
+            int begin, end;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                fn = task;
+                bandRange(band, begin, end);
+            }
+
+            if (begin < end) {
+                (*fn)(begin, end);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(int, int)>* task = nullptr;
+    int taskCount = 0;
+    int taskBands = 1;
+    int pending = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+};
+
+// Process-wide pool, grown (never shrunk) to the largest thread count asked
+// for; smaller requests just use fewer bands
+inline ThreadPool& sharedThreadPool(int threads) {
+    static std::unique_ptr<ThreadPool> pool;
+    if (!pool || pool->size() < threads) {
+        pool.reset();
+        pool.reset(new ThreadPool(std::max(threads, (int)std::thread::hardware_concurrency())));
+    }
+    return *pool;
+}
+
+// Run fn(begin, end) over [0, count) split into at most `threads`
+// contiguous ranges on the shared pool, the calling thread taking the first
+template <typename Fn>
+void parallelRanges(int count, int threads, Fn fn) {
+    threads = std::max(1, std::min(threads, count));
+    if (threads == 1) {
+        fn(0, count);
+        return;
+    }
+    sharedThreadPool(threads).parallelFor(count, threads, fn);
+}
+
+#endif
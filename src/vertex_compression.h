@@ -0,0 +1,239 @@
+// Compact GPU vertex format for the float meshes the programs generate
+// (position + normal, plus u, v with texture coordinates). Per vertex:
+//   position  4 x uint16  unorm within the mesh bounds (w is padding)
+//   normal    2 x int16   snorm octahedral encoding
+//   texcoord  2 x uint16  unorm (only with texture coordinates)
+// 12 bytes instead of 24, or 16 instead of 32 with texture coordinates.
+// Vertex shaders decode with
+//   position = positionMin + aPos.xyz * positionScale;
+//   normal = octDecode(aNormal);
+// (CPU only, no OpenGL calls.)
+#ifndef VERTEX_COMPRESSION_H
+#define VERTEX_COMPRESSION_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdint.h>
+
+// Decode transform for quantized positions: min + q * scale, q in [0, 1]
+struct MeshBounds {
+    float min[3];
+    float scale[3];
+};
+
+// uint16 slots per compressed vertex
+inline int compressedVertexShorts(bool texCoords) {
+    return texCoords ? 8 : 6;
+}
+
+// Byte offsets of the compressed attributes
+const size_t COMPRESSED_POSITION_OFFSET = 0;
+const size_t COMPRESSED_NORMAL_OFFSET = 8;
+const size_t COMPRESSED_TEXCOORD_OFFSET = 12;
+
+// Bounding box of count vertices of `stride` floats (position first)
+inline MeshBounds computeMeshBounds(const float* vertices, size_t count, int stride) {
+    float lo[3] = {0.0f, 0.0f, 0.0f};
+    float hi[3] = {0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < count; i++) {
+        const float* p = vertices + i * stride;
+        for (int c = 0; c < 3; c++) {
+            lo[c] = (i == 0) ? p[c] : std::min(lo[c], p[c]);
+            hi[c] = (i == 0) ? p[c] : std::max(hi[c], p[c]);
+        }
+    }
+
+    MeshBounds bounds;
+    for (int c = 0; c < 3; c++) {
+        bounds.min[c] = lo[c];
+        bounds.scale[c] = hi[c] - lo[c];
+    }
+    return bounds;
+}
+
+// True if every position lies inside bounds (edits can move vertices out)
+inline bool meshBoundsContain(const MeshBounds& bounds, const float* vertices, size_t count, int stride) {
+    for (size_t i = 0; i < count; i++) {
+        const float* p = vertices + i * stride;
+        for (int c = 0; c < 3; c++) {
+            if (p[c] < bounds.min[c] || p[c] > bounds.min[c] + bounds.scale[c]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+inline uint16_t quantizeUnorm16(float t) {
+    t = std::max(0.0f, std::min(1.0f, t));
+    return (uint16_t)(t * 65535.0f + 0.5f);
+}
+
+inline int16_t quantizeSnorm16(float t) {
+    t = std::max(-1.0f, std::min(1.0f, t));
+    return (int16_t)std::floor(t * 32767.0f + 0.5f);
+}
+
+// Map a unit vector onto the octahedron, then fold the lower half over the
+// diagonals so it fills the [-1, 1]^2 square. A zero vector encodes as +z.
+inline void octEncode(const float* n, int16_t* out) {
+    float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (sum < 1e-20f) {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = n[0] / sum;
+    float y = n[1] / sum;
+    if (n[2] < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    out[0] = quantizeSnorm16(x);
+    out[1] = quantizeSnorm16(y);
+}
+
+// Inverse of octEncode (same math as the GLSL octDecode)
+inline void octDecode(const int16_t* in, float* n) {
+    float x = std::max(in[0] / 32767.0f, -1.0f);
+    float y = std::max(in[1] / 32767.0f, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    float len = std::sqrt(x * x + y * y + z * z);
+    n[0] = x / len;
+    n[1] = y / len;
+    n[2] = z / len;
+}
+
+// Pack count vertices of `stride` floats (8 with texture coordinates, else 6)
+// into out, compressedVertexShorts() uint16 slots per vertex
+inline void compressVertices(const float* vertices, size_t count, int stride, const MeshBounds& bounds, uint16_t* out) {
+    bool texCoords = (stride >= 8);
+    int outStride = compressedVertexShorts(texCoords);
+    float inverseScale[3];
+    for (int c = 0; c < 3; c++) {
+        inverseScale[c] = bounds.scale[c] > 0.0f ? 1.0f / bounds.scale[c] : 0.0f;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const float* v = vertices + i * stride;
+        uint16_t* o = out + i * outStride;
+        o[0] = quantizeUnorm16((v[0] - bounds.min[0]) * inverseScale[0]);
+        o[1] = quantizeUnorm16((v[1] - bounds.min[1]) * inverseScale[1]);
+        o[2] = quantizeUnorm16((v[2] - bounds.min[2]) * inverseScale[2]);
+        o[3] = 0;
+        int16_t normal[2];
+        octEncode(v + 3, normal);
+        o[4] = (uint16_t)normal[0];
+        o[5] = (uint16_t)normal[1];
+        if (texCoords) {
+            o[6] = quantizeUnorm16(v[6]);
+            o[7] = quantizeUnorm16(v[7]);
+        }
+    }
+}
+
+// Radius of the origin-centred sphere holding count compressed vertices, as
+// decoded on the GPU. Works on the packed form so meshes mapped from the mesh
+// cache need no float copy.
+inline float compressedBoundingRadius(const uint16_t* packed, size_t count, bool texCoords, const MeshBounds& bounds) {
+    int stride = compressedVertexShorts(texCoords);
+    float radius2 = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const uint16_t* p = packed + i * stride;
+        float length2 = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float decoded = bounds.min[c] + (p[c] / 65535.0f) * bounds.scale[c];
+            length2 += decoded * decoded;
+        }
+        radius2 = std::max(radius2, length2);
+    }
+    return std::sqrt(radius2);
+}
+
+// Size and worst-case error of a compressed mesh against its float source
+struct CompressionStats {
+    size_t vertexCount;
+    size_t rawBytes;
+    size_t compressedBytes;
+    float maxPositionError;     // Object-space distance
+    float maxNormalError;       // Degrees
+    float maxTexCoordError;
+};
+
+inline CompressionStats measureCompression(const float* vertices, size_t count, int stride,
+                                           const MeshBounds& bounds, const uint16_t* packed) {
+    bool texCoords = (stride >= 8);
+    int packedStride = compressedVertexShorts(texCoords);
+
+    CompressionStats stats;
+    stats.vertexCount = count;
+    stats.rawBytes = count * stride * sizeof(float);
+    stats.compressedBytes = count * packedStride * sizeof(uint16_t);
+    stats.maxPositionError = 0.0f;
+    stats.maxNormalError = 0.0f;
+    stats.maxTexCoordError = 0.0f;
+
+    for (size_t i = 0; i < count; i++) {
+        const float* v = vertices + i * stride;
+        const uint16_t* p = packed + i * packedStride;
+
+        float error = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float decoded = bounds.min[c] + (p[c] / 65535.0f) * bounds.scale[c];
+            error += (decoded - v[c]) * (decoded - v[c]);
+        }
+        stats.maxPositionError = std::max(stats.maxPositionError, std::sqrt(error));
+
+        // Degenerate normals (zero length) have no direction to lose
+        float length = std::sqrt(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        if (length > 1e-6f) {
+            int16_t encoded[2] = {(int16_t)p[4], (int16_t)p[5]};
+            float n[3];
+            octDecode(encoded, n);
+            float cosine = (n[0] * v[3] + n[1] * v[4] + n[2] * v[5]) / length;
+            float degrees = std::acos(std::max(-1.0f, std::min(1.0f, cosine))) * 180.0f / (float)M_PI;
+            stats.maxNormalError = std::max(stats.maxNormalError, degrees);
+        }
+
+        if (texCoords) {
+            stats.maxTexCoordError = std::max(stats.maxTexCoordError, std::fabs(p[6] / 65535.0f - v[6]));
+            stats.maxTexCoordError = std::max(stats.maxTexCoordError, std::fabs(p[7] / 65535.0f - v[7]));
+        }
+    }
+    return stats;
+}
+
+inline void printCompressionStats(const char* name, const CompressionStats& stats) {
+    std::cout << "Compressed " << name << ": " << stats.vertexCount << " vertices, "
+              << stats.rawBytes << " -> " << stats.compressedBytes << " bytes ("
+              << stats.rawBytes - stats.compressedBytes << " saved), max position error "
+              << stats.maxPositionError << ", max normal error " << stats.maxNormalError << " deg";
+    if (stats.maxTexCoordError > 0.0f) {
+        std::cout << ", max texcoord error " << stats.maxTexCoordError;
+    }
+    std::cout << std::endl;
+}
+
+// Compress a whole mesh, returning its bounds; optionally report the error
+inline MeshBounds compressMesh(const char* name, const float* vertices, size_t count, int stride,
+                               std::vector<uint16_t>& packed, bool report) {
+    MeshBounds bounds = computeMeshBounds(vertices, count, stride);
+    packed.resize(count * compressedVertexShorts(stride >= 8));
+    compressVertices(vertices, count, stride, bounds, packed.data());
+    if (report) {
+        printCompressionStats(name, measureCompression(vertices, count, stride, bounds, packed.data()));
+    }
+    return bounds;
+}
+
+#endif